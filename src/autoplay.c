@@ -0,0 +1,107 @@
+#include "autoplay.h"
+
+#include <float.h>
+#include <string.h>
+
+void autoplay_features(const game_info_t *game_state, int lines,
+                       double *features) {
+  int heights[FIELD_WIDTH] = {0};
+  int holes = 0;
+
+  for (int col = 0; col < FIELD_WIDTH; col++) {
+    for (int row = 0; row < FIELD_HEIGHT; row++) {
+      if (!FIELD_ROW(game_state, row)[col].filled) {
+        holes += heights[col] > 0;
+      } else if (heights[col] == 0) {
+        heights[col] = FIELD_HEIGHT - row;
+      }
+    }
+  }
+
+  memset(features, 0, sizeof(double) * AUTOPLAY_NUM_FEATURES);
+  features[AUTOPLAY_FEATURE_LINES] = lines;
+  features[AUTOPLAY_FEATURE_HOLES] = holes;
+
+  for (int col = 0; col < FIELD_WIDTH; col++) {
+    // The field walls count as neighbours as tall as the other side
+    const int left = col > 0 ? heights[col - 1] : heights[col + 1];
+    const int right = col < FIELD_WIDTH - 1 ? heights[col + 1] : left;
+    const int wall = left < right ? left : right;
+
+    features[AUTOPLAY_FEATURE_HEIGHT] += heights[col];
+    if (col > 0) {
+      const int step = heights[col] - heights[col - 1];
+      features[AUTOPLAY_FEATURE_BUMPINESS] += step < 0 ? -step : step;
+    }
+    if (heights[col] > features[AUTOPLAY_FEATURE_MAX_HEIGHT]) {
+      features[AUTOPLAY_FEATURE_MAX_HEIGHT] = heights[col];
+    }
+    if (wall > heights[col]) {
+      features[AUTOPLAY_FEATURE_WELLS] += wall - heights[col];
+    }
+  }
+}
+
+// Replays rotate, shift and drop through handle_input on a copy, which
+// leaves the placement record in the copy for the caller to keep or discard
+static bool try_placement(const game_info_t *game_state, int rotation, int x,
+                          game_info_t *result) {
+  *result = *game_state;
+
+  for (int i = 0; i < rotation; i++) handle_input(result, USER_ACTION_ROTATE);
+  if (result->rotation != rotation) return false;
+
+  while (result->current_x != x) {
+    const int previous = result->current_x;
+    handle_input(result, x < previous ? USER_ACTION_LEFT : USER_ACTION_RIGHT);
+    if (result->current_x == previous) return false;
+  }
+
+  handle_input(result, USER_ACTION_DROP);
+  return true;
+}
+
+// Trial drops happen on copies, so only the chosen placement reaches
+// game_state->last_placement for the caller to record
+bool autoplay_move(game_info_t *game_state, const double *weights) {
+  double best_score = -DBL_MAX;
+  game_info_t best;
+  game_info_t candidate;
+  bool found = false;
+
+  for (int rotation = 0; rotation < 4; rotation++) {
+    for (int x = -3; x < FIELD_WIDTH; x++) {
+      if (!try_placement(game_state, rotation, x, &candidate)) continue;
+
+      double features[AUTOPLAY_NUM_FEATURES];
+      autoplay_features(&candidate, candidate.last_placement.lines, features);
+
+      double score = candidate.is_game_over ? -DBL_MAX / 2 : 0;
+      for (int i = 0; i < AUTOPLAY_NUM_FEATURES; i++) {
+        score += weights[i] * features[i];
+      }
+      if (score > best_score) {
+        best_score = score;
+        best = candidate;
+        found = true;
+      }
+    }
+  }
+
+  if (found) *game_state = best;
+  return found && !game_state->is_game_over;
+}
+
+int autoplay_game(unsigned long long seed, const double *weights,
+                  int max_pieces) {
+  game_info_t game_state;
+  game_timing_t timing;
+  initialize_game(&game_state, &timing);
+  seed_game(&game_state, seed);
+
+  for (int i = 0; i < max_pieces; i++) {
+    if (!autoplay_move(&game_state, weights)) break;
+  }
+
+  return game_state.score;
+}
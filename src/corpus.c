@@ -0,0 +1,417 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "corpus.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef uint8_t u8x16 __attribute__((vector_size(16)));
+
+struct corpus_writer {
+  char dir[256];
+  int segment;
+  uint32_t game;
+  size_t count;
+  size_t capacity;
+  corpus_record_t *records;
+  bool in_game;
+};
+
+static const size_t column_widths[CORPUS_NUM_COLUMNS] = {
+    sizeof(corpus_run_t),  // Game, one entry per run
+    sizeof(uint8_t),       // Piece
+    sizeof(int8_t),        // X
+    sizeof(int8_t),        // Y
+    sizeof(uint8_t),       // Rotation
+    sizeof(uint8_t),       // Lines
+    sizeof(uint8_t),       // Level
+    sizeof(uint16_t),      // Score
+    sizeof(uint8_t)};      // Game over
+
+static size_t align_offset(size_t offset) {
+  return (offset + CORPUS_ALIGNMENT - 1) & ~(size_t)(CORPUS_ALIGNMENT - 1);
+}
+
+static int record_value(const corpus_record_t *record, corpus_column_t column) {
+  switch (column) {
+    case CORPUS_COLUMN_GAME:
+      return (int)record->game;
+    case CORPUS_COLUMN_PIECE:
+      return record->piece;
+    case CORPUS_COLUMN_X:
+      return record->x;
+    case CORPUS_COLUMN_Y:
+      return record->y;
+    case CORPUS_COLUMN_ROTATION:
+      return record->rotation;
+    case CORPUS_COLUMN_LINES:
+      return record->lines;
+    case CORPUS_COLUMN_LEVEL:
+      return record->level;
+    case CORPUS_COLUMN_SCORE:
+      return record->score;
+    default:
+      return record->game_over;
+  }
+}
+
+static void write_value(uint8_t *dst, const corpus_record_t *record,
+                        corpus_column_t column) {
+  const int value = record_value(record, column);
+  if (column == CORPUS_COLUMN_SCORE) {
+    const uint16_t score = (uint16_t)value;
+    memcpy(dst, &score, sizeof(score));
+  } else {
+    *dst = (uint8_t)value;
+  }
+}
+
+static size_t build_runs(const corpus_writer_t *writer, corpus_run_t *runs) {
+  size_t count = 0;
+  for (size_t i = 0; i < writer->count; i++) {
+    if (count > 0 && runs[count - 1].game == writer->records[i].game) {
+      runs[count - 1].length++;
+    } else {
+      runs[count++] = (corpus_run_t){writer->records[i].game, 1};
+    }
+  }
+  return count;
+}
+
+static void build_header(const corpus_writer_t *writer, size_t runs,
+                         corpus_header_t *header) {
+  memset(header, 0, sizeof(corpus_header_t));
+  header->magic = CORPUS_MAGIC;
+  header->version = CORPUS_VERSION;
+  header->count = (uint32_t)writer->count;
+  header->runs = (uint32_t)runs;
+
+  size_t offset = align_offset(sizeof(corpus_header_t));
+  for (int column = 0; column < CORPUS_NUM_COLUMNS; column++) {
+    corpus_index_t *index = &header->index[column];
+    index->min = record_value(&writer->records[0], column);
+    index->max = index->min;
+    for (size_t i = 1; i < writer->count; i++) {
+      const int value = record_value(&writer->records[i], column);
+      if (value < index->min) index->min = value;
+      if (value > index->max) index->max = value;
+    }
+
+    const size_t entries = column == CORPUS_COLUMN_GAME ? runs : writer->count;
+    index->offset = offset;
+    offset = align_offset(offset + entries * column_widths[column]);
+  }
+}
+
+static bool reserve_records(corpus_writer_t *writer, size_t count) {
+  if (count <= writer->capacity) return true;
+
+  size_t capacity =
+      writer->capacity ? writer->capacity : CORPUS_SEGMENT_RECORDS;
+  while (capacity < count) capacity *= 2;
+  corpus_record_t *records =
+      realloc(writer->records, capacity * sizeof(corpus_record_t));
+  if (!records) return false;
+
+  writer->records = records;
+  writer->capacity = capacity;
+  return true;
+}
+
+static bool write_column(FILE *file, const corpus_header_t *header,
+                         int column, const void *data, size_t width,
+                         size_t count) {
+  return fseek(file, (long)header->index[column].offset, SEEK_SET) == 0 &&
+         fwrite(data, width, count, file) == count;
+}
+
+static bool write_segment(const corpus_writer_t *writer, const char *path) {
+  corpus_run_t *runs = malloc(writer->count * sizeof(corpus_run_t));
+  uint8_t *column = malloc(writer->count * sizeof(uint16_t));
+  FILE *file = runs && column ? fopen(path, "wb") : NULL;
+  bool written = file != NULL;
+
+  if (written) {
+    corpus_header_t header;
+    const size_t run_count = build_runs(writer, runs);
+    build_header(writer, run_count, &header);
+    written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              write_column(file, &header, CORPUS_COLUMN_GAME, runs,
+                           sizeof(corpus_run_t), run_count);
+
+    for (int col = CORPUS_COLUMN_PIECE; written && col < CORPUS_NUM_COLUMNS;
+         col++) {
+      const size_t width = column_widths[col];
+      for (size_t i = 0; i < writer->count; i++) {
+        write_value(&column[i * width], &writer->records[i], col);
+      }
+      written = write_column(file, &header, col, column, width, writer->count);
+    }
+  }
+
+  if (file && fclose(file) != 0) written = false;
+  free(runs);
+  free(column);
+  return written;
+}
+
+static void manifest_path(const corpus_writer_t *writer, char *path,
+                          size_t size) {
+  snprintf(path, size, "%s/%s", writer->dir, CORPUS_MANIFEST);
+}
+
+static bool save_manifest(const corpus_writer_t *writer) {
+  char path[512];
+  char temporary[520];
+  manifest_path(writer, path, sizeof(path));
+  snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+
+  FILE *file = fopen(temporary, "w");
+  if (!file) return false;
+
+  const uint32_t next_game = writer->game + (writer->in_game ? 1 : 0);
+  bool written = fprintf(file, "segment %d\ngame %u\n", writer->segment,
+                         (unsigned)next_game) > 0;
+  if (fclose(file) != 0) written = false;
+  return written && rename(temporary, path) == 0;
+}
+
+static bool load_manifest(corpus_writer_t *writer) {
+  char path[512];
+  manifest_path(writer, path, sizeof(path));
+  FILE *file = fopen(path, "r");
+  if (!file) return false;
+
+  // Only a fully parsed manifest is trusted, anything else falls back to a scan
+  int segment = -1;
+  unsigned game = 0;
+  const bool valid = fscanf(file, " segment %d", &segment) == 1 &&
+                     fscanf(file, " game %u", &game) == 1 && segment >= 0;
+  fclose(file);
+  if (!valid) return false;
+
+  writer->segment = segment;
+  writer->game = game;
+  return true;
+}
+
+// Segments are rewritten whole through a temporary file, so a failed write
+// leaves both the previous segment and the buffered records intact
+static bool flush_segment(corpus_writer_t *writer) {
+  if (writer->count == 0) return true;
+
+  char path[512];
+  char temporary[520];
+  corpus_segment_path(writer->dir, writer->segment, path, sizeof(path));
+  snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+  if (!write_segment(writer, temporary) || rename(temporary, path) != 0) {
+    remove(temporary);
+    return false;
+  }
+
+  // A partial segment stays buffered so the next flush can append to it
+  if (writer->count >= CORPUS_SEGMENT_RECORDS) {
+    writer->segment++;
+    writer->count = 0;
+  }
+  return save_manifest(writer);
+}
+
+static bool load_segment(corpus_writer_t *writer,
+                         const corpus_segment_t *segment) {
+  const size_t count = segment->header->count;
+  if (!reserve_records(writer, count)) return false;
+
+  const corpus_run_t *runs = corpus_segment_column(segment, CORPUS_COLUMN_GAME);
+  size_t i = 0;
+  for (uint32_t run = 0; run < segment->header->runs; run++) {
+    for (uint32_t j = 0; j < runs[run].length && i < count; j++) {
+      writer->records[i++].game = runs[run].game;
+    }
+  }
+
+  const uint8_t *piece = corpus_segment_column(segment, CORPUS_COLUMN_PIECE);
+  const int8_t *x = corpus_segment_column(segment, CORPUS_COLUMN_X);
+  const int8_t *y = corpus_segment_column(segment, CORPUS_COLUMN_Y);
+  const uint8_t *rotation =
+      corpus_segment_column(segment, CORPUS_COLUMN_ROTATION);
+  const uint8_t *lines = corpus_segment_column(segment, CORPUS_COLUMN_LINES);
+  const uint8_t *level = corpus_segment_column(segment, CORPUS_COLUMN_LEVEL);
+  const uint8_t *score = corpus_segment_column(segment, CORPUS_COLUMN_SCORE);
+  const uint8_t *over = corpus_segment_column(segment, CORPUS_COLUMN_GAME_OVER);
+  for (i = 0; i < count; i++) {
+    corpus_record_t *record = &writer->records[i];
+    record->piece = piece[i];
+    record->x = x[i];
+    record->y = y[i];
+    record->rotation = rotation[i];
+    record->lines = lines[i];
+    record->level = level[i];
+    memcpy(&record->score, &score[i * sizeof(uint16_t)], sizeof(uint16_t));
+    record->game_over = over[i];
+  }
+
+  writer->count = count;
+  return true;
+}
+
+// Reopens the current segment: partial ones are buffered to be extended
+static void resume_segment(corpus_writer_t *writer) {
+  char path[512];
+  corpus_segment_t segment;
+  corpus_segment_path(writer->dir, writer->segment, path, sizeof(path));
+  if (!corpus_segment_open(path, &segment)) return;
+
+  if (segment.header->count >= CORPUS_SEGMENT_RECORDS ||
+      !load_segment(writer, &segment)) {
+    writer->segment++;
+  }
+  corpus_segment_close(&segment);
+}
+
+// Only needed for directories written before the manifest existed
+static void scan_segments(corpus_writer_t *writer) {
+  char path[512];
+  corpus_segment_t segment;
+
+  while (1) {
+    corpus_segment_path(writer->dir, writer->segment, path, sizeof(path));
+    if (!corpus_segment_open(path, &segment)) break;
+
+    const uint32_t last_game =
+        (uint32_t)segment.header->index[CORPUS_COLUMN_GAME].max;
+    if (last_game >= writer->game) writer->game = last_game + 1;
+    corpus_segment_close(&segment);
+    writer->segment++;
+  }
+  if (writer->segment > 0) writer->segment--;
+}
+
+corpus_writer_t *corpus_open(const char *dir) {
+  mkdir(dir, 0755);
+
+  corpus_writer_t *writer = calloc(1, sizeof(corpus_writer_t));
+  if (!writer) return NULL;
+
+  snprintf(writer->dir, sizeof(writer->dir), "%s", dir);
+  if (!load_manifest(writer)) {
+    writer->segment = 0;
+    writer->game = 0;
+    scan_segments(writer);
+  }
+  resume_segment(writer);
+  return writer;
+}
+
+bool corpus_append(corpus_writer_t *writer, const corpus_record_t *record) {
+  if (!writer) return true;
+  if (!reserve_records(writer, writer->count + 1)) return false;
+
+  corpus_record_t *stored = &writer->records[writer->count++];
+  *stored = *record;
+  stored->game = writer->game;
+  writer->in_game = !record->game_over;
+
+  if (!record->game_over) return true;
+  writer->game++;
+  return writer->count < CORPUS_SEGMENT_RECORDS || flush_segment(writer);
+}
+
+bool corpus_close(corpus_writer_t *writer) {
+  if (!writer) return true;
+
+  // An unfinished game still owns its id
+  if (writer->in_game) {
+    writer->game++;
+    writer->in_game = false;
+  }
+  const bool flushed = flush_segment(writer) && save_manifest(writer);
+  free(writer->records);
+  free(writer);
+  return flushed;
+}
+
+void corpus_segment_path(const char *dir, int segment, char *path,
+                         size_t size) {
+  snprintf(path, size, "%s/segment-%06d.col", dir, segment);
+}
+
+bool corpus_segment_open(const char *path, corpus_segment_t *segment) {
+  memset(segment, 0, sizeof(corpus_segment_t));
+
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  bool valid =
+      fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(corpus_header_t);
+  if (valid) {
+    segment->size = (size_t)st.st_size;
+    segment->base = mmap(NULL, segment->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    valid = segment->base != MAP_FAILED;
+  }
+  close(fd);
+  if (!valid) {
+    segment->base = NULL;
+    return false;
+  }
+
+  segment->header = segment->base;
+  valid = segment->header->magic == CORPUS_MAGIC &&
+          segment->header->version == CORPUS_VERSION;
+  for (int col = 0; valid && col < CORPUS_NUM_COLUMNS; col++) {
+    const size_t entries = col == CORPUS_COLUMN_GAME ? segment->header->runs
+                                                     : segment->header->count;
+    valid = segment->header->index[col].offset + entries * column_widths[col] <=
+            segment->size;
+  }
+
+  if (!valid) corpus_segment_close(segment);
+  return valid;
+}
+
+const void *corpus_segment_column(const corpus_segment_t *segment,
+                                  corpus_column_t column) {
+  return (const uint8_t *)segment->base + segment->header->index[column].offset;
+}
+
+bool corpus_segment_overlaps(const corpus_segment_t *segment,
+                             corpus_column_t column, int min, int max) {
+  const corpus_index_t *index = &segment->header->index[column];
+  return segment->header->count > 0 && index->min <= max && index->max >= min;
+}
+
+void corpus_segment_close(corpus_segment_t *segment) {
+  if (segment->base) munmap(segment->base, segment->size);
+  memset(segment, 0, sizeof(corpus_segment_t));
+}
+
+size_t corpus_scan_range(const uint8_t *column, size_t count, uint8_t min,
+                         uint8_t max, uint8_t *mask) {
+  const u8x16 lo = (u8x16){0} + min;
+  const u8x16 hi = (u8x16){0} + max;
+  size_t matches = 0;
+  size_t i = 0;
+
+  for (; i + sizeof(u8x16) <= count; i += sizeof(u8x16)) {
+    u8x16 values;
+    memcpy(&values, &column[i], sizeof(values));
+    const u8x16 hits = (u8x16)((values >= lo) & (values <= hi));
+    memcpy(&mask[i], &hits, sizeof(hits));
+
+    const u8x16 ones = hits & 1;
+    for (size_t j = 0; j < sizeof(u8x16); j++) matches += ones[j];
+  }
+
+  for (; i < count; i++) {
+    mask[i] = column[i] >= min && column[i] <= max ? 0xff : 0;
+    matches += mask[i] & 1;
+  }
+
+  return matches;
+}
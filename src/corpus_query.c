@@ -0,0 +1,201 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "corpus.h"
+
+#define MAX_LEVEL 10
+#define MAX_ENDING 6
+#define TOP_ENDINGS 20
+
+static const char piece_names[] = "?IOTLJSZ";
+
+typedef struct {
+  unsigned long pieces;
+  unsigned long clears[5];
+  unsigned long score;
+  unsigned int best;
+} level_stats_t;
+
+typedef struct {
+  unsigned int key;
+  unsigned long count;
+} ending_t;
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s levels [-d dir] [-l min-max]\n"
+          "       %s endings [-d dir] [-n length]\n",
+          name, name);
+}
+
+static void scan_levels(const corpus_segment_t *segment, int min, int max,
+                        level_stats_t *stats, uint8_t *mask) {
+  const size_t count = segment->header->count;
+  const uint8_t *level = corpus_segment_column(segment, CORPUS_COLUMN_LEVEL);
+  const uint8_t *lines = corpus_segment_column(segment, CORPUS_COLUMN_LINES);
+  const uint16_t *score = corpus_segment_column(segment, CORPUS_COLUMN_SCORE);
+
+  if (corpus_scan_range(level, count, min, max, mask) == 0) return;
+
+  for (size_t i = 0; i < count; i++) {
+    if (!mask[i]) continue;
+
+    level_stats_t *entry = &stats[level[i]];
+    entry->pieces++;
+    entry->clears[lines[i] > 4 ? 4 : lines[i]]++;
+    entry->score += score[i];
+    if (score[i] > entry->best) entry->best = score[i];
+  }
+}
+
+static int query_levels(const char *dir, int min, int max) {
+  level_stats_t stats[MAX_LEVEL + 1] = {0};
+  int scanned = 0;
+  int skipped = 0;
+  char path[512];
+  corpus_segment_t segment;
+
+  for (int i = 0;; i++) {
+    corpus_segment_path(dir, i, path, sizeof(path));
+    if (!corpus_segment_open(path, &segment)) break;
+
+    uint8_t *mask = malloc(segment.header->count);
+    if (!corpus_segment_overlaps(&segment, CORPUS_COLUMN_LEVEL, min, max)) {
+      skipped++;
+    } else if (mask) {
+      scan_levels(&segment, min, max, stats, mask);
+      scanned++;
+    }
+    free(mask);
+    corpus_segment_close(&segment);
+  }
+
+  printf("%-6s %10s %8s %8s %8s %8s %12s %8s\n", "LEVEL", "PIECES", "SINGLE",
+         "DOUBLE", "TRIPLE", "TETRIS", "SCORE", "BEST");
+  for (int level = min; level <= max && level <= MAX_LEVEL; level++) {
+    const level_stats_t *entry = &stats[level];
+    if (entry->pieces == 0) continue;
+    printf("%-6d %10lu %8lu %8lu %8lu %8lu %12lu %8u\n", level, entry->pieces,
+           entry->clears[1], entry->clears[2], entry->clears[3],
+           entry->clears[4], entry->score, entry->best);
+  }
+  printf("segments: %d scanned, %d skipped by index\n", scanned, skipped);
+  return EXIT_SUCCESS;
+}
+
+static unsigned int ending_key(const uint8_t *piece, size_t start, size_t end) {
+  unsigned int key = 0;
+  for (size_t i = start; i < end; i++) key = key * 8 + piece[i];
+  return key;
+}
+
+static void count_endings(const corpus_segment_t *segment, int length,
+                          unsigned long *counts, unsigned long *games) {
+  const corpus_run_t *runs = corpus_segment_column(segment, CORPUS_COLUMN_GAME);
+  const uint8_t *piece = corpus_segment_column(segment, CORPUS_COLUMN_PIECE);
+  const uint8_t *over = corpus_segment_column(segment, CORPUS_COLUMN_GAME_OVER);
+  size_t start = 0;
+
+  for (uint32_t run = 0; run < segment->header->runs; run++) {
+    const size_t end = start + runs[run].length;
+    if (end - start >= (size_t)length && over[end - 1]) {
+      counts[ending_key(piece, end - length, end)]++;
+      (*games)++;
+    }
+    start = end;
+  }
+}
+
+static int compare_endings(const void *a, const void *b) {
+  const ending_t *lhs = a;
+  const ending_t *rhs = b;
+  if (lhs->count != rhs->count) return lhs->count < rhs->count ? 1 : -1;
+  return lhs->key < rhs->key ? -1 : lhs->key > rhs->key;
+}
+
+static int query_endings(const char *dir, int length) {
+  const size_t keys = (size_t)1 << (3 * length);
+  unsigned long *counts = calloc(keys, sizeof(unsigned long));
+  unsigned long games = 0;
+  char path[512];
+  corpus_segment_t segment;
+
+  if (!counts) return EXIT_FAILURE;
+
+  for (int i = 0;; i++) {
+    corpus_segment_path(dir, i, path, sizeof(path));
+    if (!corpus_segment_open(path, &segment)) break;
+
+    if (corpus_segment_overlaps(&segment, CORPUS_COLUMN_GAME_OVER, 1, 1)) {
+      count_endings(&segment, length, counts, &games);
+    }
+    corpus_segment_close(&segment);
+  }
+
+  ending_t top[TOP_ENDINGS + 1];
+  int found = 0;
+  for (size_t key = 0; key < keys; key++) {
+    if (!counts[key]) continue;
+    top[found] = (ending_t){(unsigned int)key, counts[key]};
+    qsort(top, found + 1, sizeof(ending_t), compare_endings);
+    if (found < TOP_ENDINGS) found++;
+  }
+  free(counts);
+
+  printf("%-*s %10s\n", MAX_ENDING, "ENDING", "GAMES");
+  for (int i = 0; i < found; i++) {
+    char sequence[MAX_ENDING + 1] = {0};
+    for (int j = length - 1, key = top[i].key; j >= 0; j--, key /= 8) {
+      sequence[j] = piece_names[key % 8];
+    }
+    printf("%-*s %10lu\n", MAX_ENDING, sequence, top[i].count);
+  }
+  printf("games ended: %lu\n", games);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const char *command = argv[1];
+  const char *dir = CORPUS_DIR;
+  int min = 1;
+  int max = MAX_LEVEL;
+  int length = 3;
+  int opt;
+
+  optind = 2;
+  while ((opt = getopt(argc, argv, "d:l:n:")) != -1) {
+    switch (opt) {
+      case 'd':
+        dir = optarg;
+        break;
+      case 'l':
+        if (sscanf(optarg, "%d-%d", &min, &max) == 1) max = min;
+        break;
+      case 'n':
+        length = atoi(optarg);
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (strcmp(command, "levels") == 0 && min >= 0 && min <= max) {
+    return query_levels(dir, min, max > MAX_LEVEL ? MAX_LEVEL : max);
+  }
+  if (strcmp(command, "endings") == 0 && length > 0 && length <= MAX_ENDING) {
+    return query_endings(dir, length);
+  }
+
+  usage(argv[0]);
+  return EXIT_FAILURE;
+}
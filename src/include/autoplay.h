@@ -0,0 +1,26 @@
+#ifndef AUTOPLAY_H
+#define AUTOPLAY_H
+
+#include <stdbool.h>
+
+#include "tetris.h"
+
+#define AUTOPLAY_MAX_PIECES 500
+
+typedef enum {
+  AUTOPLAY_FEATURE_HEIGHT,
+  AUTOPLAY_FEATURE_LINES,
+  AUTOPLAY_FEATURE_HOLES,
+  AUTOPLAY_FEATURE_BUMPINESS,
+  AUTOPLAY_FEATURE_MAX_HEIGHT,
+  AUTOPLAY_FEATURE_WELLS,
+  AUTOPLAY_NUM_FEATURES
+} autoplay_feature_t;
+
+void autoplay_features(const game_info_t *game_state, int lines,
+                       double *features);
+bool autoplay_move(game_info_t *game_state, const double *weights);
+int autoplay_game(unsigned long long seed, const double *weights,
+                  int max_pieces);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CORPUS_DIR "corpus"
+#define CORPUS_MANIFEST "manifest"
+#define CORPUS_MAGIC 0x4c4f4354  // "TCOL"
+#define CORPUS_VERSION 1
+#define CORPUS_SEGMENT_RECORDS 65536
+#define CORPUS_ALIGNMENT 64
+
+typedef enum {
+  CORPUS_COLUMN_GAME,
+  CORPUS_COLUMN_PIECE,
+  CORPUS_COLUMN_X,
+  CORPUS_COLUMN_Y,
+  CORPUS_COLUMN_ROTATION,
+  CORPUS_COLUMN_LINES,
+  CORPUS_COLUMN_LEVEL,
+  CORPUS_COLUMN_SCORE,
+  CORPUS_COLUMN_GAME_OVER,
+  CORPUS_NUM_COLUMNS
+} corpus_column_t;
+
+// One locked piece, as appended by the game
+typedef struct {
+  uint32_t game;
+  uint8_t piece;
+  int8_t x;
+  int8_t y;
+  uint8_t rotation;
+  uint8_t lines;
+  uint8_t level;
+  uint16_t score;
+  bool game_over;
+} corpus_record_t;
+
+// Games never span segments, so the game column is stored as runs
+typedef struct {
+  uint32_t game;
+  uint32_t length;
+} corpus_run_t;
+
+typedef struct {
+  int32_t min;
+  int32_t max;
+  uint64_t offset;
+} corpus_index_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t count;
+  uint32_t runs;
+  corpus_index_t index[CORPUS_NUM_COLUMNS];
+} corpus_header_t;
+
+typedef struct {
+  void *base;
+  size_t size;
+  const corpus_header_t *header;
+} corpus_segment_t;
+
+typedef struct corpus_writer corpus_writer_t;
+
+corpus_writer_t *corpus_open(const char *dir);
+bool corpus_append(corpus_writer_t *writer, const corpus_record_t *record);
+bool corpus_close(corpus_writer_t *writer);
+
+void corpus_segment_path(const char *dir, int segment, char *path, size_t size);
+bool corpus_segment_open(const char *path, corpus_segment_t *segment);
+const void *corpus_segment_column(const corpus_segment_t *segment,
+                                  corpus_column_t column);
+bool corpus_segment_overlaps(const corpus_segment_t *segment,
+                             corpus_column_t column, int min, int max);
+void corpus_segment_close(corpus_segment_t *segment);
+
+size_t corpus_scan_range(const uint8_t *column, size_t count, uint8_t min,
+                         uint8_t max, uint8_t *mask);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "tetris.h"
+
+#define ACTION_QUEUE_SIZE 64
+#define SIMULATION_TICK_MS 16
+#define CACHE_LINE 64
+
+// Single-producer single-consumer ring of actions, input -> simulation
+typedef struct {
+  user_action_t actions[ACTION_QUEUE_SIZE];
+  _Alignas(CACHE_LINE) atomic_size_t head;
+  _Alignas(CACHE_LINE) atomic_size_t tail;
+  unsigned long dropped;
+} action_queue_t;
+
+// Triple-buffered game_info_t snapshots, simulation -> render
+typedef struct {
+  game_info_t snapshots[3];
+  _Alignas(CACHE_LINE) atomic_int middle;
+  int back;
+  int front;
+  unsigned long published;
+  unsigned long coalesced;
+} snapshot_buffer_t;
+
+void action_queue_init(action_queue_t *queue);
+bool action_queue_push(action_queue_t *queue, user_action_t action);
+bool action_queue_pop(action_queue_t *queue, user_action_t *action);
+
+void snapshot_buffer_init(snapshot_buffer_t *buffer,
+                          const game_info_t *game_state);
+void snapshot_publish(snapshot_buffer_t *buffer, const game_info_t *game_state);
+const game_info_t *snapshot_acquire(snapshot_buffer_t *buffer);
+
+#endif
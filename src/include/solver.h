@@ -0,0 +1,38 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdbool.h>
+
+#include "tetris.h"
+
+#define SOLVER_MAX_PIECES 16
+#define SOLVER_MEMO_BITS 18
+
+typedef struct {
+  int rotation;
+  int x;
+  int y;
+} solver_move_t;
+
+typedef struct {
+  solver_move_t moves[SOLVER_MAX_PIECES];
+  int length;
+  unsigned long long nodes;
+} solver_result_t;
+
+typedef struct solver solver_t;
+
+// A solver keeps its worker memo tables across problems; create one per run
+// and reuse it for every board
+solver_t *solver_create(int threads);
+bool solver_solve(solver_t *solver, const game_info_t *game_state,
+                  const piece_t *queue, int queue_length,
+                  solver_result_t *result);
+void solver_destroy(solver_t *solver);
+
+// One-off solve with a solver created just for this call
+bool solve_perfect_clear(const game_info_t *game_state, const piece_t *queue,
+                         int queue_length, int threads,
+                         solver_result_t *result);
+
+#endif
@@ -2,7 +2,6 @@
 #define TETRIS_H
 
 #include <stdbool.h>
-#include <sys/time.h>
 
 #define FIELD_WIDTH 10
 #define FIELD_HEIGHT 20
@@ -12,6 +11,9 @@
 
 #define HIGHSCORE_TXT "highscore.txt"
 
+// Field rows are read through the row table, so clears never move cells
+#define FIELD_ROW(game_state, y) ((game_state)->cells[(game_state)->rows[(y)]])
+
 typedef enum {
   GAME_STATE_START,
   GAME_STATE_MOVING,
@@ -40,14 +42,28 @@ typedef struct {
   bool filled;
 } cell_t;
 
+// A locked piece and what it scored, for callers that keep a game history
+typedef struct {
+  int piece;
+  int x;
+  int y;
+  int rotation;
+  int lines;
+  int level;
+  int score;
+  bool game_over;
+} placement_info_t;
+
 typedef struct {
-  cell_t field[FIELD_HEIGHT][FIELD_WIDTH];
+  cell_t cells[FIELD_HEIGHT][FIELD_WIDTH];
+  int rows[FIELD_HEIGHT];
   piece_t next;
   piece_t current;
   int current_x;
   int current_y;
   int shadow_x;
   int shadow_y;
+  int rotation;
   int score;
   int high_score;
   int level;
@@ -55,15 +71,26 @@ typedef struct {
   bool pause;
   bool is_game_over;
   bool is_speeding;
+  unsigned long long random_state;
+  // Plain values so copies stay side effect free; the owner of the live game
+  // appends last_placement whenever placements advances
+  placement_info_t last_placement;
+  unsigned long placements;
 } game_info_t;
 
 typedef struct {
   game_state_t state;
+  // Simulated milliseconds, advanced by the caller; gravity never reads the
+  // wall clock so it stays in step with the simulation ticks
+  unsigned long clock;
   unsigned long last_update;
 } game_timing_t;
 
 void handle_input(game_info_t *game_state, user_action_t action);
 game_info_t update_game_state(game_info_t *game_state, game_timing_t *timing);
 void initialize_game(game_info_t *game_state, game_timing_t *timing);
+void seed_game(game_info_t *game_state, unsigned long long seed);
+unsigned long long next_random(unsigned long long *state);
+piece_t get_piece(unsigned index);
 
 #endif
@@ -1,10 +1,37 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
 #include <ncurses.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "corpus.h"
+#include "pipeline.h"
 #include "tetris.h"
 
+#define INPUT_POLL_MS 10
+
+typedef enum {
+  KEY_STATE_NONE,
+  KEY_STATE_ESCAPE,
+  KEY_STATE_SEQUENCE
+} key_state_t;
+
+typedef struct {
+  game_info_t game_state;
+  game_timing_t timing;
+  action_queue_t actions;
+  snapshot_buffer_t snapshots;
+  atomic_bool done;
+  unsigned long dropped_ticks;
+  corpus_writer_t *corpus;
+  unsigned long recorded;
+} pipeline_t;
+
 void initialize_colors() {
   start_color();
   use_default_colors();
@@ -129,51 +156,200 @@ user_action_t get_key_action(int ch) {
   return action;
 }
 
+// Arrow keys arrive as ESC [ x, or ESC O x in keypad transmit mode
+int decode_key(key_state_t *state, unsigned char byte) {
+  static const int arrows[] = {KEY_UP, KEY_DOWN, KEY_RIGHT, KEY_LEFT};
+  int key = ERR;
+
+  if (*state == KEY_STATE_ESCAPE) {
+    *state = byte == '[' || byte == 'O' ? KEY_STATE_SEQUENCE : KEY_STATE_NONE;
+  } else if (*state == KEY_STATE_SEQUENCE) {
+    if (byte >= 'A' && byte <= 'D') key = arrows[byte - 'A'];
+    *state = KEY_STATE_NONE;
+  } else if (byte == 27) {
+    *state = KEY_STATE_ESCAPE;
+  } else {
+    key = byte;
+  }
+
+  return key;
+}
+
+unsigned long monotonic_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Sleeps until the given tick is due and returns how many ticks were missed.
+// Missed ticks are skipped rather than replayed in a burst
+unsigned long wait_for_tick(unsigned long start, unsigned long tick) {
+  const unsigned long deadline = start + tick * SIMULATION_TICK_MS;
+  const unsigned long now = monotonic_ms();
+  if (now < deadline) {
+    const unsigned long delay = deadline - now;
+    nanosleep(&(struct timespec){delay / 1000, (delay % 1000) * 1000000}, NULL);
+    return 0;
+  }
+  return (now - deadline) / SIMULATION_TICK_MS;
+}
+
+void *input_loop(void *arg) {
+  pipeline_t *pipeline = arg;
+  key_state_t state = KEY_STATE_NONE;
+  struct pollfd fd = {.fd = STDIN_FILENO, .events = POLLIN};
+
+  while (!atomic_load(&pipeline->done)) {
+    const int ready = poll(&fd, 1, INPUT_POLL_MS);
+    if (ready < 0 && errno != EINTR) break;
+    if (ready <= 0) continue;
+
+    unsigned char bytes[32];
+    const ssize_t length = read(STDIN_FILENO, bytes, sizeof(bytes));
+    if (length < 0 && errno == EINTR) continue;
+    // End of input or a hangup, nothing more will ever arrive
+    if (length <= 0) break;
+
+    for (ssize_t i = 0; i < length; i++) {
+      const int key = decode_key(&state, bytes[i]);
+      if (key != ERR) {
+        action_queue_push(&pipeline->actions, get_key_action(key));
+      }
+    }
+  }
+
+  return NULL;
+}
+
+// Each step locks at most one piece, so checking after every step is enough
+void record_placement(pipeline_t *pipeline) {
+  const game_info_t *game_state = &pipeline->game_state;
+  if (game_state->placements == pipeline->recorded) return;
+
+  const placement_info_t *placement = &game_state->last_placement;
+  const corpus_record_t record = {.piece = placement->piece,
+                                  .x = placement->x,
+                                  .y = placement->y,
+                                  .rotation = placement->rotation,
+                                  .lines = placement->lines,
+                                  .level = placement->level,
+                                  .score = placement->score,
+                                  .game_over = placement->game_over};
+  corpus_append(pipeline->corpus, &record);
+  pipeline->recorded = game_state->placements;
+}
+
+void *simulation_loop(void *arg) {
+  pipeline_t *pipeline = arg;
+  const unsigned long start = monotonic_ms();
+  unsigned long tick = 0;
+
+  while (!pipeline->game_state.is_game_over && !atomic_load(&pipeline->done)) {
+    user_action_t action = USER_ACTION_NONE;
+    bool handled = false;
+    while (action_queue_pop(&pipeline->actions, &action)) {
+      handle_input(&pipeline->game_state, action);
+      record_placement(pipeline);
+      handled = true;
+    }
+    if (!handled) handle_input(&pipeline->game_state, USER_ACTION_NONE);
+
+    // Gravity runs on simulated time so it never drifts from the tick rate
+    pipeline->timing.clock = tick * SIMULATION_TICK_MS;
+    update_game_state(&pipeline->game_state, &pipeline->timing);
+    record_placement(pipeline);
+    snapshot_publish(&pipeline->snapshots, &pipeline->game_state);
+
+    const unsigned long dropped = wait_for_tick(start, ++tick);
+    pipeline->dropped_ticks += dropped;
+    tick += dropped;
+  }
+
+  atomic_store(&pipeline->done, true);
+  return NULL;
+}
+
+void draw_frame(const game_info_t *game_state) {
+  erase();
+
+  draw_borders();
+  draw_shadow(game_state);
+  // Current tetromino piece
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      draw_piece(i, j, game_state);
+    }
+  }
+
+  // Leftover tetromino blocks
+  for (int i = 0; i < FIELD_HEIGHT; i++) {
+    const cell_t *row = FIELD_ROW(game_state, i);
+    for (int j = 0; j < FIELD_WIDTH; j++) {
+      if (row[j].filled) draw_block(i, j, row[j].color);
+    }
+  }
+
+  draw_sidebar(game_state);
+  refresh();
+}
+
 int main() {
   initscr();
   cbreak();
   noecho();
-  keypad(stdscr, TRUE);
-  nodelay(stdscr, TRUE);
   curs_set(0);
 
   if (has_colors()) initialize_colors();
 
-  game_info_t game_state;
-  game_timing_t timing;
-  initialize_game(&game_state, &timing);
-
-  while (!game_state.is_game_over) {
-    user_action_t action = get_key_action(getch());
-    handle_input(&game_state, action);
-    update_game_state(&game_state, &timing);
-
-    erase();
+  static pipeline_t pipeline;
+  initialize_game(&pipeline.game_state, &pipeline.timing);
+  pipeline.corpus = corpus_open(CORPUS_DIR);
+  action_queue_init(&pipeline.actions);
+  snapshot_buffer_init(&pipeline.snapshots, &pipeline.game_state);
+  atomic_init(&pipeline.done, false);
 
-    draw_borders();
-    draw_shadow(&game_state);
-    // Current tetromino piece
-    for (int i = 0; i < 4; i++) {
-      for (int j = 0; j < 4; j++) {
-        draw_piece(i, j, &game_state);
-      }
-    }
+  pthread_t input_thread;
+  pthread_t simulation_thread;
+  const bool input_started =
+      !pthread_create(&input_thread, NULL, input_loop, &pipeline);
+  const bool simulation_started =
+      input_started &&
+      !pthread_create(&simulation_thread, NULL, simulation_loop, &pipeline);
+  if (!simulation_started) {
+    atomic_store(&pipeline.done, true);
+    if (input_started) pthread_join(input_thread, NULL);
+    corpus_close(pipeline.corpus);
+    endwin();
+    fprintf(stderr, "Cannot start the game threads\n");
+    return EXIT_FAILURE;
+  }
 
-    // Leftover tetromino blocks
-    for (int i = 0; i < FIELD_HEIGHT; i++) {
-      for (int j = 0; j < FIELD_WIDTH; j++) {
-        if (game_state.field[i][j].filled)
-          draw_block(i, j, game_state.field[i][j].color);
-      }
+  // Render on the main thread, only when the simulation published a frame
+  unsigned long rendered = 0;
+  while (!atomic_load(&pipeline.done)) {
+    const game_info_t *snapshot = snapshot_acquire(&pipeline.snapshots);
+    if (snapshot) {
+      draw_frame(snapshot);
+      rendered++;
+    } else {
+      napms(1);
     }
-
-    draw_sidebar(&game_state);
-    refresh();
-    napms(16);
   }
 
+  pthread_join(simulation_thread, NULL);
+  pthread_join(input_thread, NULL);
+
+  const game_info_t *game_state = &pipeline.game_state;
+  const bool recorded = corpus_close(pipeline.corpus);
   endwin();
-  printf("Game Over!\nFinal Score: %d\nHigh Score: %d\n", game_state.score,
-         game_state.high_score);
+  if (!recorded) {
+    fprintf(stderr, "Cannot write game history to %s\n", CORPUS_DIR);
+  }
+  printf("Game Over!\nFinal Score: %d\nHigh Score: %d\n", game_state->score,
+         game_state->high_score);
+  printf("Frames: %lu simulated, %lu rendered, %lu coalesced, %lu dropped\n",
+         pipeline.snapshots.published, rendered, pipeline.snapshots.coalesced,
+         pipeline.dropped_ticks);
+  printf("Inputs dropped: %lu\n", pipeline.actions.dropped);
   return 0;
 }
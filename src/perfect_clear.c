@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 200809L
+// macOS hides _SC_NPROCESSORS_ONLN under plain POSIX
+#define _DARWIN_C_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "solver.h"
+
+#define MAX_LINE 1024
+
+static const char piece_names[] = "IOTLJSZ";
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s [-t threads] < boards\n"
+          "Each line is a piece queue, active piece first, then optional\n"
+          "field rows from top to bottom separated by '/', with X or #\n"
+          "for filled and . for empty cells, e.g.\n"
+          "  IOO XXXXXX..../XXXXXX..../XXXXXX..XX/XXXXXX..XX\n",
+          name);
+}
+
+static int piece_index(char name) {
+  const char *found = strchr(piece_names, name);
+  return name && found ? (int)(found - piece_names) : -1;
+}
+
+// Rows are bottom aligned, so the last row given is the floor
+static bool parse_board(char *line, game_info_t *game_state, piece_t *queue,
+                        int *queue_length, int *pieces) {
+  char *save = NULL;
+  const char *names = strtok_r(line, " \t\n", &save);
+  const char *field = strtok_r(NULL, " \t\n", &save);
+  if (!names) return false;
+
+  *queue_length = (int)strlen(names) - 1;
+  if (*queue_length < 0 || *queue_length >= SOLVER_MAX_PIECES) return false;
+  for (int i = 0; names[i]; i++) {
+    pieces[i] = piece_index(names[i]);
+    if (pieces[i] < 0) return false;
+    if (i > 0) queue[i - 1] = get_piece(pieces[i]);
+  }
+
+  initialize_game(game_state, (game_timing_t[]){0});
+  game_state->current = get_piece(pieces[0]);
+  game_state->current_x = FIELD_WIDTH / 2 - 2;
+  game_state->current_y = 0;
+
+  int rows = 0;
+  for (const char *c = field; c && *c; c++) rows += *c == '/';
+  int row = FIELD_HEIGHT - 1 - rows;
+  for (int col = 0; field && *field && row < FIELD_HEIGHT; field++) {
+    if (*field == '/') {
+      row++;
+      col = 0;
+    } else if (row < 0 || col >= FIELD_WIDTH || !strchr("X#.", *field)) {
+      return false;
+    } else {
+      FIELD_ROW(game_state, row)[col++].filled = *field != '.';
+    }
+  }
+
+  return true;
+}
+
+// Drops the rest of an overlong line so it is not read as another board
+static bool read_whole_line(char *line, size_t size) {
+  const size_t length = strlen(line);
+  if (length + 1 < size || line[length - 1] == '\n') return true;
+
+  // A full buffer followed directly by the newline was still a whole line
+  bool overlong = false;
+  int c;
+  while ((c = getchar()) != EOF && c != '\n') overlong = true;
+  return !overlong;
+}
+
+static void print_solution(int number, const int *pieces,
+                           const solver_result_t *result) {
+  printf("%d: solved in %d:", number, result->length);
+  for (int i = 0; i < result->length; i++) {
+    const solver_move_t *move = &result->moves[i];
+    printf("%s %c r%d x%d y%d", i ? "," : "", piece_names[pieces[i]],
+           move->rotation, move->x, move->y);
+  }
+  printf("\n");
+}
+
+int main(int argc, char **argv) {
+  const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  int threads = cores > 0 ? (int)cores : 1;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:")) != -1) {
+    if (opt != 't' || (threads = atoi(optarg)) < 1) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  solver_t *solver = solver_create(threads);
+  if (!solver) {
+    fprintf(stderr, "Cannot allocate the solver\n");
+    return EXIT_FAILURE;
+  }
+
+  char line[MAX_LINE];
+  int number = 0;
+  int solved = 0;
+  unsigned long long nodes = 0;
+  struct timespec start;
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  while (fgets(line, sizeof(line), stdin)) {
+    game_info_t game_state;
+    piece_t queue[SOLVER_MAX_PIECES];
+    int pieces[SOLVER_MAX_PIECES];
+    int queue_length;
+    solver_result_t result;
+
+    const bool whole = read_whole_line(line, sizeof(line));
+    if (whole && strspn(line, " \t\n") == strlen(line)) continue;
+    number++;
+    if (!whole ||
+        !parse_board(line, &game_state, queue, &queue_length, pieces)) {
+      printf("%d: invalid board\n", number);
+      continue;
+    }
+
+    if (solver_solve(solver, &game_state, queue, queue_length, &result)) {
+      print_solution(number, pieces, &result);
+      solved++;
+    } else {
+      printf("%d: no solution\n", number);
+    }
+    nodes += result.nodes;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  solver_destroy(solver);
+  const double seconds =
+      (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  fprintf(stderr, "boards: %d, solved: %d, nodes: %llu, %.3fs (%.0f nodes/s)\n",
+          number, solved, nodes, seconds, seconds > 0 ? nodes / seconds : 0);
+  return EXIT_SUCCESS;
+}
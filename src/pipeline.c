@@ -0,0 +1,72 @@
+#include "pipeline.h"
+
+#include <string.h>
+
+#define SNAPSHOT_FRESH 4
+
+void action_queue_init(action_queue_t *queue) {
+  memset(queue->actions, 0, sizeof(queue->actions));
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+  queue->dropped = 0;
+}
+
+bool action_queue_push(action_queue_t *queue, user_action_t action) {
+  const size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  const size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+  if (tail - head == ACTION_QUEUE_SIZE) {
+    queue->dropped++;
+    return false;
+  }
+
+  queue->actions[tail % ACTION_QUEUE_SIZE] = action;
+  atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+bool action_queue_pop(action_queue_t *queue, user_action_t *action) {
+  const size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  const size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+  if (head == tail) return false;
+
+  *action = queue->actions[head % ACTION_QUEUE_SIZE];
+  atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+  return true;
+}
+
+void snapshot_buffer_init(snapshot_buffer_t *buffer,
+                          const game_info_t *game_state) {
+  for (int i = 0; i < 3; i++) buffer->snapshots[i] = *game_state;
+  buffer->back = 0;
+  atomic_init(&buffer->middle, 1);
+  buffer->front = 2;
+  buffer->published = 0;
+  buffer->coalesced = 0;
+}
+
+void snapshot_publish(snapshot_buffer_t *buffer,
+                      const game_info_t *game_state) {
+  buffer->snapshots[buffer->back] = *game_state;
+  const int previous =
+      atomic_exchange_explicit(&buffer->middle, buffer->back | SNAPSHOT_FRESH,
+                               memory_order_acq_rel);
+
+  // The renderer never saw the snapshot we just replaced
+  if (previous & SNAPSHOT_FRESH) buffer->coalesced++;
+  buffer->back = previous & ~SNAPSHOT_FRESH;
+  buffer->published++;
+}
+
+const game_info_t *snapshot_acquire(snapshot_buffer_t *buffer) {
+  if (!(atomic_load_explicit(&buffer->middle, memory_order_relaxed) &
+        SNAPSHOT_FRESH)) {
+    return NULL;
+  }
+
+  const int previous = atomic_exchange_explicit(&buffer->middle, buffer->front,
+                                                memory_order_acq_rel);
+  buffer->front = previous & ~SNAPSHOT_FRESH;
+  return &buffer->snapshots[buffer->front];
+}
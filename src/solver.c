@@ -0,0 +1,476 @@
+#include "solver.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FULL_ROW ((1 << FIELD_WIDTH) - 1)
+#define EVEN_COLUMNS (0x5555 & FULL_ROW)
+#define MAX_DELTA (4 * SOLVER_MAX_PIECES)
+#define MAX_PLACEMENTS (4 * (FIELD_WIDTH + 3))
+#define MEMO_ROWS 12
+#define MEMO_HALF (MEMO_ROWS / 2)
+
+typedef enum { SEARCH_FAILED, SEARCH_FOUND, SEARCH_ABORTED } search_t;
+
+typedef struct {
+  uint16_t rows[FIELD_HEIGHT];
+} board_t;
+
+typedef struct {
+  uint16_t mask[4];
+  int min_col;
+  int max_col;
+} shape_t;
+
+typedef struct {
+  shape_t rotations[4];
+  bool distinct[4];
+  int start_x;
+  int start_y;
+} solver_piece_t;
+
+typedef struct {
+  solver_move_t move;
+  board_t child;
+} placement_t;
+
+// Memo tables outlive a single problem, so entries carry the problem stamp
+typedef struct {
+  uint64_t low;
+  uint64_t high;
+  int depth;
+  uint32_t stamp;
+} memo_entry_t;
+
+typedef struct {
+  solver_piece_t pieces[SOLVER_MAX_PIECES];
+  int length;
+  // reachable[depth][k]: column balances the k pieces from depth can cancel
+  bool reachable[SOLVER_MAX_PIECES + 1][SOLVER_MAX_PIECES + 1]
+                [2 * MAX_DELTA + 1];
+  placement_t roots[MAX_PLACEMENTS];
+  int root_count;
+  atomic_int next_root;
+  atomic_int best_root;
+  uint32_t stamp;
+} problem_t;
+
+typedef struct {
+  problem_t *problem;
+  memo_entry_t *memo;
+  int root;
+  solver_move_t path[SOLVER_MAX_PIECES];
+  int depth;
+  solver_move_t solution[SOLVER_MAX_PIECES];
+  int solution_length;
+  int solution_root;
+  unsigned long long nodes;
+} worker_t;
+
+struct solver {
+  problem_t problem;
+  worker_t *workers;
+  pthread_t *handles;
+  int threads;
+};
+
+static void build_shape(const int shape[4][4], shape_t *result) {
+  memset(result, 0, sizeof(shape_t));
+  result->min_col = 4;
+  result->max_col = -1;
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      if (!shape[i][j]) continue;
+      result->mask[i] |= 1 << j;
+      if (j < result->min_col) result->min_col = j;
+      if (j > result->max_col) result->max_col = j;
+    }
+  }
+}
+
+// Same clockwise rotation as the game, so every move replays in handle_input
+static void build_piece(const piece_t *piece, int x, int y,
+                        solver_piece_t *result) {
+  piece_t current = *piece;
+  result->start_x = x;
+  result->start_y = y;
+
+  for (int r = 0; r < 4; r++) {
+    build_shape(current.shape, &result->rotations[r]);
+    result->distinct[r] = true;
+    for (int other = 0; other < r; other++) {
+      if (memcmp(result->rotations[other].mask, result->rotations[r].mask,
+                 sizeof(result->rotations[r].mask)) == 0) {
+        result->distinct[r] = false;
+      }
+    }
+
+    piece_t rotated = current;
+    for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++) rotated.shape[j][3 - i] = current.shape[i][j];
+    current = rotated;
+  }
+}
+
+static uint16_t shift_mask(uint16_t mask, int x) {
+  return x >= 0 ? (uint16_t)(mask << x) : (uint16_t)(mask >> -x);
+}
+
+static bool collides(const board_t *board, const shape_t *shape, int x, int y) {
+  if (x + shape->min_col < 0 || x + shape->max_col >= FIELD_WIDTH) return true;
+
+  for (int i = 0; i < 4; i++) {
+    if (!shape->mask[i]) continue;
+
+    const int row = y + i;
+    if (row >= FIELD_HEIGHT) return true;
+    if (row >= 0 && (board->rows[row] & shift_mask(shape->mask[i], x))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Locks the shape and clears full rows, refusing cells above the field
+static bool place(const board_t *board, const shape_t *shape, int x, int y,
+                  board_t *child) {
+  *child = *board;
+  for (int i = 0; i < 4; i++) {
+    if (!shape->mask[i]) continue;
+    if (y + i < 0) return false;
+    child->rows[y + i] |= shift_mask(shape->mask[i], x);
+  }
+
+  int target = FIELD_HEIGHT - 1;
+  for (int row = FIELD_HEIGHT - 1; row >= 0; row--) {
+    if (child->rows[row] != FULL_ROW) child->rows[target--] = child->rows[row];
+  }
+  while (target >= 0) child->rows[target--] = 0;
+  return true;
+}
+
+static void add_placement(const board_t *board, const shape_t *shape,
+                          int rotation, int x, int y, placement_t *placements,
+                          int *count) {
+  while (!collides(board, shape, x, y + 1)) y++;
+
+  placement_t *placement = &placements[*count];
+  if (place(board, shape, x, y, &placement->child)) {
+    placement->move = (solver_move_t){rotation, x, y};
+    (*count)++;
+  }
+}
+
+// Rotations at the start position, then single steps sideways, then drop
+static int enumerate_placements(const board_t *board,
+                                const solver_piece_t *piece,
+                                placement_t *placements) {
+  const int x = piece->start_x;
+  const int y = piece->start_y;
+  int count = 0;
+
+  for (int r = 0; r < 4; r++) {
+    const shape_t *shape = &piece->rotations[r];
+    if (collides(board, shape, x, y)) break;
+    if (!piece->distinct[r]) continue;
+
+    add_placement(board, shape, r, x, y, placements, &count);
+    for (int left = x - 1; !collides(board, shape, left, y); left--) {
+      add_placement(board, shape, r, left, y, placements, &count);
+    }
+    for (int right = x + 1; !collides(board, shape, right, y); right++) {
+      add_placement(board, shape, r, right, y, placements, &count);
+    }
+  }
+
+  return count;
+}
+
+static int column_balance(uint16_t row) {
+  return __builtin_popcount(row & EVEN_COLUMNS) -
+         __builtin_popcount(row & ~EVEN_COLUMNS & FULL_ROW);
+}
+
+// Clears remove as many even as odd column cells, so only pieces move the
+// balance: L and J always by 2, T and I by 0 or 2 and 0 or 4, O, S, Z never
+static void build_parity(problem_t *problem) {
+  int deltas[SOLVER_MAX_PIECES][8];
+  int delta_counts[SOLVER_MAX_PIECES] = {0};
+
+  for (int p = 0; p < problem->length; p++) {
+    for (int r = 0; r < 4; r++) {
+      int delta = 0;
+      for (int i = 0; i < 4; i++) {
+        delta += column_balance(problem->pieces[p].rotations[r].mask[i]);
+      }
+      deltas[p][delta_counts[p]++] = delta;
+      deltas[p][delta_counts[p]++] = -delta;
+    }
+  }
+
+  memset(problem->reachable, 0, sizeof(problem->reachable));
+  for (int depth = 0; depth <= problem->length; depth++) {
+    problem->reachable[depth][0][MAX_DELTA] = true;
+    for (int k = 1; depth + k <= problem->length; k++) {
+      const bool *previous = problem->reachable[depth][k - 1];
+      bool *current = problem->reachable[depth][k];
+      const int p = depth + k - 1;
+      for (int sum = 0; sum <= 2 * MAX_DELTA; sum++) {
+        if (!previous[sum]) continue;
+        for (int d = 0; d < delta_counts[p]; d++) {
+          const int next = sum + deltas[p][d];
+          if (next >= 0 && next <= 2 * MAX_DELTA) current[next] = true;
+        }
+      }
+    }
+  }
+}
+
+static int board_height(const board_t *board) {
+  for (int row = 0; row < FIELD_HEIGHT; row++) {
+    if (board->rows[row]) return FIELD_HEIGHT - row;
+  }
+  return 0;
+}
+
+// Some prefix of the remaining pieces must fill whole rows covering the
+// stack while cancelling its column balance
+static bool is_feasible(const problem_t *problem, const board_t *board,
+                        int depth) {
+  const int height = board_height(board);
+  int filled = 0;
+  int balance = 0;
+  for (int row = FIELD_HEIGHT - height; row < FIELD_HEIGHT; row++) {
+    filled += __builtin_popcount(board->rows[row]);
+    balance += column_balance(board->rows[row]);
+  }
+  if (balance > MAX_DELTA || balance < -MAX_DELTA) return false;
+
+  for (int k = 1; depth + k <= problem->length; k++) {
+    const int cells = filled + 4 * k;
+    if (cells % FIELD_WIDTH || cells / FIELD_WIDTH < height) continue;
+    if (problem->reachable[depth][k][MAX_DELTA - balance]) return true;
+  }
+  return false;
+}
+
+static memo_entry_t *memo_slot(worker_t *worker, const board_t *board,
+                               int depth, uint64_t *low, uint64_t *high) {
+  *low = 0;
+  *high = 0;
+  for (int i = 0; i < MEMO_HALF; i++) {
+    const int row = FIELD_HEIGHT - 1 - i;
+    *low = (*low << FIELD_WIDTH) | board->rows[row];
+    *high = (*high << FIELD_WIDTH) | board->rows[row - MEMO_HALF];
+  }
+
+  uint64_t hash = (*low * 0x9e3779b97f4a7c15ULL) ^
+                  (*high * 0xc2b2ae3d27d4eb4fULL) ^
+                  ((uint64_t)depth * 0x165667b19e3779f9ULL);
+  hash = (hash ^ (hash >> 29)) * 0xff51afd7ed558ccdULL;
+  return &worker->memo[hash >> (64 - SOLVER_MEMO_BITS)];
+}
+
+static search_t search(worker_t *worker, const board_t *board, int depth) {
+  problem_t *problem = worker->problem;
+  worker->nodes++;
+
+  if (board_height(board) == 0) {
+    worker->depth = depth;
+    return SEARCH_FOUND;
+  }
+  if (atomic_load_explicit(&problem->best_root, memory_order_relaxed) <
+      worker->root) {
+    return SEARCH_ABORTED;
+  }
+  if (!is_feasible(problem, board, depth)) return SEARCH_FAILED;
+
+  // Only failures are memoized, so the table is a lossy cache
+  memo_entry_t *slot = NULL;
+  uint64_t low;
+  uint64_t high;
+  if (board_height(board) <= MEMO_ROWS) {
+    slot = memo_slot(worker, board, depth, &low, &high);
+    if (slot->stamp == problem->stamp && slot->depth == depth + 1 &&
+        slot->low == low && slot->high == high) {
+      return SEARCH_FAILED;
+    }
+  }
+
+  placement_t placements[MAX_PLACEMENTS];
+  const int count =
+      enumerate_placements(board, &problem->pieces[depth], placements);
+  for (int i = 0; i < count; i++) {
+    worker->path[depth] = placements[i].move;
+    const search_t result = search(worker, &placements[i].child, depth + 1);
+    if (result != SEARCH_FAILED) return result;
+  }
+
+  if (slot) *slot = (memo_entry_t){low, high, depth + 1, problem->stamp};
+  return SEARCH_FAILED;
+}
+
+static void lower_best_root(problem_t *problem, int root) {
+  int best = atomic_load(&problem->best_root);
+  while (root < best &&
+         !atomic_compare_exchange_weak(&problem->best_root, &best, root)) {
+    continue;
+  }
+}
+
+// Roots are handed out in order; later roots stop once an earlier one wins
+static void *solve_roots(void *arg) {
+  worker_t *worker = arg;
+  problem_t *problem = worker->problem;
+
+  while (1) {
+    const int root = atomic_fetch_add(&problem->next_root, 1);
+    if (root >= problem->root_count ||
+        root > atomic_load(&problem->best_root)) {
+      break;
+    }
+
+    worker->root = root;
+    worker->path[0] = problem->roots[root].move;
+    if (search(worker, &problem->roots[root].child, 1) == SEARCH_FOUND) {
+      memcpy(worker->solution, worker->path, sizeof(worker->path));
+      worker->solution_length = worker->depth;
+      worker->solution_root = root;
+      lower_best_root(problem, root);
+    }
+  }
+
+  return NULL;
+}
+
+solver_t *solver_create(int threads) {
+  solver_t *solver = calloc(1, sizeof(solver_t));
+  if (threads < 1) threads = 1;
+  if (solver) {
+    solver->workers = calloc(threads, sizeof(worker_t));
+    solver->handles = calloc(threads, sizeof(pthread_t));
+  }
+  if (!solver || !solver->workers || !solver->handles) {
+    solver_destroy(solver);
+    return NULL;
+  }
+
+  // Run with fewer workers rather than fail when memory is short
+  for (int t = 0; t < threads; t++) {
+    memo_entry_t *memo =
+        calloc((size_t)1 << SOLVER_MEMO_BITS, sizeof(memo_entry_t));
+    if (!memo) break;
+    solver->workers[solver->threads++].memo = memo;
+  }
+  if (solver->threads == 0) {
+    solver_destroy(solver);
+    return NULL;
+  }
+  return solver;
+}
+
+void solver_destroy(solver_t *solver) {
+  if (!solver) return;
+  for (int t = 0; solver->workers && t < solver->threads; t++) {
+    free(solver->workers[t].memo);
+  }
+  free(solver->workers);
+  free(solver->handles);
+  free(solver);
+}
+
+static void next_stamp(solver_t *solver) {
+  if (++solver->problem.stamp != 0) return;
+
+  // Wrapped around: old entries would look current again
+  for (int t = 0; t < solver->threads; t++) {
+    memset(solver->workers[t].memo, 0,
+           sizeof(memo_entry_t) << SOLVER_MEMO_BITS);
+  }
+  solver->problem.stamp = 1;
+}
+
+bool solver_solve(solver_t *solver, const game_info_t *game_state,
+                  const piece_t *queue, int queue_length,
+                  solver_result_t *result) {
+  memset(result, 0, sizeof(solver_result_t));
+  if (queue_length < 0 || queue_length >= SOLVER_MAX_PIECES) return false;
+
+  problem_t *problem = &solver->problem;
+  next_stamp(solver);
+  problem->length = queue_length + 1;
+  build_piece(&game_state->current, game_state->current_x,
+              game_state->current_y, &problem->pieces[0]);
+  for (int i = 0; i < queue_length; i++) {
+    build_piece(&queue[i], FIELD_WIDTH / 2 - 2, 0, &problem->pieces[i + 1]);
+  }
+  build_parity(problem);
+
+  board_t board;
+  for (int row = 0; row < FIELD_HEIGHT; row++) {
+    board.rows[row] = 0;
+    for (int col = 0; col < FIELD_WIDTH; col++) {
+      if (FIELD_ROW(game_state, row)[col].filled) board.rows[row] |= 1 << col;
+    }
+  }
+
+  problem->root_count = is_feasible(problem, &board, 0)
+                            ? enumerate_placements(&board, &problem->pieces[0],
+                                                   problem->roots)
+                            : 0;
+  atomic_init(&problem->next_root, 0);
+  atomic_init(&problem->best_root, INT_MAX);
+  const int threads = solver->threads < problem->root_count
+                          ? solver->threads
+                          : problem->root_count;
+
+  worker_t *workers = solver->workers;
+  int started = 0;
+  for (int t = 0; t < threads; t++) {
+    workers[t] = (worker_t){.problem = problem,
+                            .memo = workers[t].memo,
+                            .solution_root = INT_MAX};
+    if (!pthread_create(&solver->handles[started], NULL, solve_roots,
+                        &workers[t])) {
+      started++;
+    }
+  }
+  // Without any thread the roots are still searched, just serially
+  if (threads > 0 && started == 0) solve_roots(&workers[0]);
+  for (int t = 0; t < started; t++) pthread_join(solver->handles[t], NULL);
+
+  const worker_t *winner = NULL;
+  result->nodes = 1;
+  for (int t = 0; t < threads; t++) {
+    result->nodes += workers[t].nodes;
+    if (workers[t].solution_length > 0 &&
+        (!winner || workers[t].solution_root < winner->solution_root)) {
+      winner = &workers[t];
+    }
+  }
+  if (winner) {
+    result->length = winner->solution_length;
+    memcpy(result->moves, winner->solution, sizeof(result->moves));
+  }
+
+  return winner != NULL;
+}
+
+bool solve_perfect_clear(const game_info_t *game_state, const piece_t *queue,
+                         int queue_length, int threads,
+                         solver_result_t *result) {
+  solver_t *solver = solver_create(threads);
+  if (!solver) {
+    memset(result, 0, sizeof(solver_result_t));
+    return false;
+  }
+
+  const bool solved =
+      solver_solve(solver, game_state, queue, queue_length, result);
+  solver_destroy(solver);
+  return solved;
+}
@@ -42,7 +42,9 @@ static bool check_collision(const game_info_t *game_state) {
       const int x = game_state->current_x + j;
       const int y = game_state->current_y + i;
       const bool out_of_bounds = x < 0 || x >= FIELD_WIDTH || y >= FIELD_HEIGHT;
-      const bool collision = y >= 0 && game_state->field[y][x].filled;
+      // Only cells inside the field may go through the row table
+      const bool collision =
+          !out_of_bounds && y >= 0 && FIELD_ROW(game_state, y)[x].filled;
 
       if (out_of_bounds || collision) {
         flag = true;
@@ -66,11 +68,25 @@ static void compute_shadow_position(game_info_t *game_state) {
   game_state->shadow_y = shadow.current_y;
 }
 
+// splitmix64 over a caller owned state; games keep theirs per game so seeded
+// games replay identically on any thread
+unsigned long long next_random(unsigned long long *state) {
+  unsigned long long z = (*state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static piece_t random_piece(game_info_t *game_state) {
+  return all_pieces[next_random(&game_state->random_state) % NUM_PIECES];
+}
+
 static void spawn_new_piece(game_info_t *game_state) {
   game_state->current = game_state->next;
-  game_state->next = all_pieces[rand() % NUM_PIECES];
+  game_state->next = random_piece(game_state);
   game_state->current_x = FIELD_WIDTH / 2 - 2;
   game_state->current_y = 0;
+  game_state->rotation = 0;
   compute_shadow_position(game_state);
 }
 
@@ -83,36 +99,37 @@ static void lock_piece(game_info_t *game_state) {
       const int y = game_state->current_y + i;
       if (y < 0 || y >= FIELD_HEIGHT) continue;
 
-      game_state->field[y][x].filled = true;
-      game_state->field[y][x].color = game_state->current.color_code;
+      FIELD_ROW(game_state, y)[x].filled = true;
+      FIELD_ROW(game_state, y)[x].color = game_state->current.color_code;
     }
   }
 }
 
+static bool is_row_full(const cell_t *row) {
+  bool full = true;
+  for (int col = 0; col < FIELD_WIDTH && full; col++) full = row[col].filled;
+  return full;
+}
+
 static int clear_completed_lines(game_info_t *game_state) {
+  int cleared_rows[FIELD_HEIGHT];
   int lines_cleared = 0;
+  int target = FIELD_HEIGHT - 1;
 
+  // Single compaction pass over row indices, kept rows sink to the bottom
   for (int row = FIELD_HEIGHT - 1; row >= 0; row--) {
-    bool line_full = true;
-
-    for (int col = 0; col < FIELD_WIDTH; col++) {
-      if (!game_state->field[row][col].filled) {
-        line_full = false;
-        break;
-      }
+    const int index = game_state->rows[row];
+    if (is_row_full(game_state->cells[index])) {
+      cleared_rows[lines_cleared++] = index;
+    } else {
+      game_state->rows[target--] = index;
     }
+  }
 
-    if (line_full) {
-      lines_cleared++;
-
-      // Move down tetromino blocks
-      for (int i = row; i > 0; i--) {
-        memcpy(&game_state->field[i], &game_state->field[i - 1],
-               sizeof(cell_t) * FIELD_WIDTH);
-      }
-      memset(&game_state->field[0], 0, sizeof(cell_t) * FIELD_WIDTH);
-      row++;
-    }
+  // Cleared rows are recycled as empty rows on top
+  for (int i = 0; i < lines_cleared; i++) {
+    memset(game_state->cells[cleared_rows[i]], 0, sizeof(cell_t) * FIELD_WIDTH);
+    game_state->rows[i] = cleared_rows[i];
   }
 
   return lines_cleared;
@@ -125,6 +142,30 @@ static void update_score(game_info_t *game_state, int lines_cleared) {
   game_state->level = game_state->level > 10 ? 10 : game_state->level;
 }
 
+static bool attach_piece(game_info_t *game_state) {
+  placement_info_t placement = {.piece = game_state->current.color_code,
+                                .x = game_state->current_x,
+                                .y = game_state->current_y,
+                                .rotation = game_state->rotation,
+                                .level = game_state->level};
+  const int score = game_state->score;
+
+  lock_piece(game_state);
+  const int lines = clear_completed_lines(game_state);
+  if (lines > 0) update_score(game_state, lines);
+
+  // Immediate piece spawn and collision check
+  spawn_new_piece(game_state);
+  const bool game_over = check_collision(game_state);
+
+  placement.lines = lines;
+  placement.score = game_state->score - score;
+  placement.game_over = game_over;
+  game_state->last_placement = placement;
+  game_state->placements++;
+  return game_over;
+}
+
 static void handle_movement(game_info_t *game_state) {
   const int speed = game_state->is_speeding ? SPEED_MULTIPLIER : 1;
   game_state->speed = BASE_FALL_INTERVAL / (game_state->level * speed);
@@ -155,7 +196,11 @@ static void handle_action_rotate(game_info_t *game_state) {
 
   const piece_t original = game_state->current;
   game_state->current = rotated;
-  if (check_collision(game_state)) game_state->current = original;
+  if (check_collision(game_state)) {
+    game_state->current = original;
+  } else {
+    game_state->rotation = (game_state->rotation + 1) % 4;
+  }
   compute_shadow_position(game_state);
 }
 
@@ -175,12 +220,7 @@ static void handle_action_drop(game_info_t *game_state) {
       break;
     }
   }
-  lock_piece(game_state);
-  int lines_cleared = clear_completed_lines(game_state);
-  if (lines_cleared > 0) update_score(game_state, lines_cleared);
-
-  spawn_new_piece(game_state);
-  if (check_collision(game_state)) game_state->is_game_over = true;
+  if (attach_piece(game_state)) game_state->is_game_over = true;
 }
 
 static void handle_action_none(game_info_t *game_state) {
@@ -229,14 +269,8 @@ static void handle_state_moving(game_info_t *game_state, game_timing_t *timing)
 }
 
 static void handle_state_attaching(game_info_t *game_state, game_timing_t *timing) {
-  lock_piece(game_state);
-  const int lines = clear_completed_lines(game_state);
-  if (lines > 0) update_score(game_state, lines);
-
-  // Immediate piece spawn and collision check
-  spawn_new_piece(game_state);
   timing->state =
-      check_collision(game_state) ? GAME_STATE_GAME_OVER : GAME_STATE_MOVING;
+      attach_piece(game_state) ? GAME_STATE_GAME_OVER : GAME_STATE_MOVING;
 }
 
 static void handle_state_game_over(game_info_t *game_state, game_timing_t *timing) {
@@ -276,26 +310,27 @@ static void execute_state(game_info_t *game_state, game_timing_t *timing) {
 }
 
 game_info_t update_game_state(game_info_t *game_state, game_timing_t *timing) {
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  const unsigned long current_time = tv.tv_sec * 1000 + tv.tv_usec / 1000;
+  const unsigned long current_time = timing->clock;
 
   if (timing->state == GAME_STATE_START) {
     load_high_score(game_state);
-    srand(time(NULL));
-    game_state->next = all_pieces[rand() % NUM_PIECES];
-    spawn_new_piece(game_state);
+    seed_game(game_state, time(NULL));
     timing->state = GAME_STATE_MOVING;
     timing->last_update = current_time;
   }
 
   bool is_stopped = game_state->pause || game_state->is_game_over;
-  bool less_than_interval =
-      current_time - timing->last_update <= (unsigned long)game_state->speed;
+  const unsigned long interval = game_state->speed;
+  bool less_than_interval = current_time - timing->last_update < interval;
 
   if (!is_stopped && !less_than_interval) {
     execute_state(game_state, timing);
-    timing->last_update = current_time;
+    // Step by the interval so the next fall keeps its phase; rebase only
+    // after a pause or a level change left gravity more than a step behind
+    timing->last_update += interval;
+    if (current_time - timing->last_update >= interval) {
+      timing->last_update = current_time;
+    }
   }
 
   return *game_state;
@@ -304,6 +339,7 @@ game_info_t update_game_state(game_info_t *game_state, game_timing_t *timing) {
 void initialize_game(game_info_t *game_state, game_timing_t *timing) {
   memset(game_state, 0, sizeof(game_info_t));
   memset(timing, 0, sizeof(game_timing_t));
+  for (int row = 0; row < FIELD_HEIGHT; row++) game_state->rows[row] = row;
 
   game_state->next = all_pieces[0];
   spawn_new_piece(game_state);
@@ -312,3 +348,12 @@ void initialize_game(game_info_t *game_state, game_timing_t *timing) {
   game_state->level = 1;
   game_state->speed = BASE_FALL_INTERVAL;
 }
+
+void seed_game(game_info_t *game_state, unsigned long long seed) {
+  game_state->random_state = seed;
+  game_state->next = random_piece(game_state);
+  spawn_new_piece(game_state);
+}
+
+// Unsigned so the modulo always lands inside the table
+piece_t get_piece(unsigned index) { return all_pieces[index % NUM_PIECES]; }
@@ -0,0 +1,343 @@
+#define _POSIX_C_SOURCE 200809L
+// macOS hides _SC_NPROCESSORS_ONLN under plain POSIX
+#define _DARWIN_C_SOURCE
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "autoplay.h"
+
+#define TUNE_CHECKPOINT "tune.ckpt"
+#define MAX_THREADS 256
+#define TWO_PI 6.283185307179586
+
+typedef struct {
+  int generations;
+  int population;
+  int elite;
+  int games;
+  int pieces;
+  int threads;
+  unsigned long long seed;
+  const char *checkpoint;
+  bool resume;
+} tune_options_t;
+
+typedef struct {
+  int generation;
+  unsigned long long seed;
+  double mean[AUTOPLAY_NUM_FEATURES];
+  double stddev[AUTOPLAY_NUM_FEATURES];
+  double best[AUTOPLAY_NUM_FEATURES];
+  double best_fitness;
+} tune_state_t;
+
+typedef struct {
+  const tune_options_t *options;
+  const double *candidates;
+  unsigned long long *game_seeds;
+  int *scores;
+  atomic_int next_job;
+} tune_batch_t;
+
+typedef struct {
+  int index;
+  double fitness;
+} ranked_t;
+
+static double sample_normal(unsigned long long *state) {
+  const double u1 = ((next_random(state) >> 11) + 1.0) / 9007199254740993.0;
+  const double u2 = (next_random(state) >> 11) / 9007199254740992.0;
+  return sqrt(-2.0 * log(u1)) * cos(TWO_PI * u2);
+}
+
+// Every stream derives from (seed, generation, purpose), never thread order
+static unsigned long long derive_seed(unsigned long long seed, int generation,
+                                      int purpose) {
+  unsigned long long state =
+      seed ^ ((unsigned long long)generation << 32) ^ (unsigned)purpose;
+  return next_random(&state);
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s [-g generations] [-p population] [-e elite] "
+          "[-n games] [-m pieces] [-t threads] [-s seed] [-c checkpoint] "
+          "[-r]\n",
+          name);
+}
+
+static bool parse_options(int argc, char **argv, tune_options_t *options) {
+  const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  *options = (tune_options_t){.generations = 30,
+                              .population = 64,
+                              .elite = 0,
+                              .games = 8,
+                              .pieces = AUTOPLAY_MAX_PIECES,
+                              .threads = cores > 0 ? (int)cores : 1,
+                              .seed = 1,
+                              .checkpoint = TUNE_CHECKPOINT,
+                              .resume = false};
+  int opt;
+
+  while ((opt = getopt(argc, argv, "g:p:e:n:m:t:s:c:r")) != -1) {
+    switch (opt) {
+      case 'g':
+        options->generations = atoi(optarg);
+        break;
+      case 'p':
+        options->population = atoi(optarg);
+        break;
+      case 'e':
+        options->elite = atoi(optarg);
+        break;
+      case 'n':
+        options->games = atoi(optarg);
+        break;
+      case 'm':
+        options->pieces = atoi(optarg);
+        break;
+      case 't':
+        options->threads = atoi(optarg);
+        break;
+      case 's':
+        options->seed = strtoull(optarg, NULL, 10);
+        break;
+      case 'c':
+        options->checkpoint = optarg;
+        break;
+      case 'r':
+        options->resume = true;
+        break;
+      default:
+        return false;
+    }
+  }
+
+  if (options->elite <= 0) options->elite = options->population / 4;
+  if (options->threads > MAX_THREADS) options->threads = MAX_THREADS;
+  return options->generations > 0 && options->population > 1 &&
+         options->elite > 0 && options->elite <= options->population &&
+         options->games > 0 && options->pieces > 0 && options->threads > 0;
+}
+
+static void write_weights(FILE *file, const char *label,
+                          const double *values) {
+  fprintf(file, "%s", label);
+  for (int i = 0; i < AUTOPLAY_NUM_FEATURES; i++) {
+    fprintf(file, " %.17g", values[i]);
+  }
+  fprintf(file, "\n");
+}
+
+static bool read_weights(FILE *file, const char *label, double *values) {
+  char name[32];
+  bool valid = fscanf(file, "%31s", name) == 1 && strcmp(name, label) == 0;
+  for (int i = 0; valid && i < AUTOPLAY_NUM_FEATURES; i++) {
+    valid = fscanf(file, "%lf", &values[i]) == 1;
+  }
+  return valid;
+}
+
+static bool save_checkpoint(const char *path, const tune_options_t *options,
+                            const tune_state_t *state) {
+  char temporary[512];
+  snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+
+  FILE *file = fopen(temporary, "w");
+  if (!file) return false;
+
+  fprintf(file, "generation %d\n", state->generation);
+  fprintf(file, "seed %llu\n", state->seed);
+  fprintf(file, "population %d\n", options->population);
+  fprintf(file, "elite %d\n", options->elite);
+  fprintf(file, "games %d\n", options->games);
+  fprintf(file, "pieces %d\n", options->pieces);
+  fprintf(file, "fitness %.17g\n", state->best_fitness);
+  write_weights(file, "mean", state->mean);
+  write_weights(file, "stddev", state->stddev);
+  write_weights(file, "best", state->best);
+  const bool written = fclose(file) == 0;
+
+  // Rename so an interrupted run never leaves a torn checkpoint behind
+  return written && rename(temporary, path) == 0;
+}
+
+// The settings a checkpoint was written with go to saved, for the caller to
+// compare; resuming with others would mix incomparable fitness values
+static bool load_checkpoint(const char *path, tune_options_t *saved,
+                            tune_state_t *state) {
+  FILE *file = fopen(path, "r");
+  if (!file) return false;
+
+  const bool valid =
+      fscanf(file, " generation %d", &state->generation) == 1 &&
+      fscanf(file, " seed %llu", &state->seed) == 1 &&
+      fscanf(file, " population %d", &saved->population) == 1 &&
+      fscanf(file, " elite %d", &saved->elite) == 1 &&
+      fscanf(file, " games %d", &saved->games) == 1 &&
+      fscanf(file, " pieces %d", &saved->pieces) == 1 &&
+      fscanf(file, " fitness %lf", &state->best_fitness) == 1 &&
+      read_weights(file, "mean", state->mean) &&
+      read_weights(file, "stddev", state->stddev) &&
+      read_weights(file, "best", state->best);
+  fclose(file);
+  return valid;
+}
+
+static void *play_games(void *arg) {
+  tune_batch_t *batch = arg;
+  const tune_options_t *options = batch->options;
+  const int jobs = options->population * options->games;
+
+  while (1) {
+    const int job = atomic_fetch_add(&batch->next_job, 1);
+    if (job >= jobs) break;
+
+    const int candidate = job / options->games;
+    const int game = job % options->games;
+    batch->scores[job] =
+        autoplay_game(batch->game_seeds[game],
+                      &batch->candidates[candidate * AUTOPLAY_NUM_FEATURES],
+                      options->pieces);
+  }
+
+  return NULL;
+}
+
+static int compare_ranked(const void *a, const void *b) {
+  const ranked_t *lhs = a;
+  const ranked_t *rhs = b;
+  if (lhs->fitness != rhs->fitness) {
+    return lhs->fitness < rhs->fitness ? 1 : -1;
+  }
+  return lhs->index - rhs->index;
+}
+
+static void run_generation(const tune_options_t *options, tune_state_t *state,
+                           double *candidates, unsigned long long *game_seeds,
+                           int *scores, ranked_t *ranked) {
+  unsigned long long sampler = derive_seed(state->seed, state->generation, -1);
+  for (int c = 0; c < options->population; c++) {
+    for (int i = 0; i < AUTOPLAY_NUM_FEATURES; i++) {
+      candidates[c * AUTOPLAY_NUM_FEATURES + i] =
+          state->mean[i] + state->stddev[i] * sample_normal(&sampler);
+    }
+  }
+
+  // All candidates of a generation play the same games
+  for (int g = 0; g < options->games; g++) {
+    game_seeds[g] = derive_seed(state->seed, state->generation, g);
+  }
+
+  tune_batch_t batch = {.options = options,
+                        .candidates = candidates,
+                        .game_seeds = game_seeds,
+                        .scores = scores};
+  atomic_init(&batch.next_job, 0);
+
+  // Jobs are pulled from a shared counter, so any number of started workers
+  // finishes the batch; the calling thread helps out as well
+  pthread_t threads[MAX_THREADS];
+  int started = 0;
+  for (int t = 1; t < options->threads; t++) {
+    if (!pthread_create(&threads[started], NULL, play_games, &batch)) {
+      started++;
+    }
+  }
+  play_games(&batch);
+  for (int t = 0; t < started; t++) pthread_join(threads[t], NULL);
+
+  for (int c = 0; c < options->population; c++) {
+    double total = 0;
+    for (int g = 0; g < options->games; g++) {
+      total += scores[c * options->games + g];
+    }
+    ranked[c] = (ranked_t){c, total / options->games};
+  }
+  qsort(ranked, options->population, sizeof(ranked_t), compare_ranked);
+
+  // Cross-entropy update: refit the distribution to the elite candidates
+  const double noise = 1.0 / (state->generation + 1);
+  for (int i = 0; i < AUTOPLAY_NUM_FEATURES; i++) {
+    double mean = 0;
+    double variance = 0;
+    for (int e = 0; e < options->elite; e++) {
+      mean += candidates[ranked[e].index * AUTOPLAY_NUM_FEATURES + i];
+    }
+    mean /= options->elite;
+    for (int e = 0; e < options->elite; e++) {
+      const double delta =
+          candidates[ranked[e].index * AUTOPLAY_NUM_FEATURES + i] - mean;
+      variance += delta * delta;
+    }
+    state->mean[i] = mean;
+    state->stddev[i] = sqrt(variance / options->elite + noise);
+  }
+
+  if (ranked[0].fitness > state->best_fitness) {
+    state->best_fitness = ranked[0].fitness;
+    memcpy(state->best, &candidates[ranked[0].index * AUTOPLAY_NUM_FEATURES],
+           sizeof(state->best));
+  }
+  state->generation++;
+}
+
+int main(int argc, char **argv) {
+  tune_options_t options;
+  if (!parse_options(argc, argv, &options)) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  tune_state_t state = {.seed = options.seed, .best_fitness = -1};
+  for (int i = 0; i < AUTOPLAY_NUM_FEATURES; i++) state.stddev[i] = 1.0;
+  tune_options_t saved;
+  if (options.resume && !load_checkpoint(options.checkpoint, &saved, &state)) {
+    fprintf(stderr, "Cannot resume from %s\n", options.checkpoint);
+    return EXIT_FAILURE;
+  }
+  if (options.resume &&
+      (saved.population != options.population ||
+       saved.elite != options.elite || saved.games != options.games ||
+       saved.pieces != options.pieces)) {
+    fprintf(stderr,
+            "%s was written with -p %d -e %d -n %d -m %d, resume with the "
+            "same settings\n",
+            options.checkpoint, saved.population, saved.elite, saved.games,
+            saved.pieces);
+    return EXIT_FAILURE;
+  }
+
+  double *candidates =
+      malloc(sizeof(double) * options.population * AUTOPLAY_NUM_FEATURES);
+  unsigned long long *game_seeds =
+      malloc(sizeof(unsigned long long) * options.games);
+  int *scores = malloc(sizeof(int) * options.population * options.games);
+  ranked_t *ranked = malloc(sizeof(ranked_t) * options.population);
+  if (!candidates || !game_seeds || !scores || !ranked) return EXIT_FAILURE;
+
+  while (state.generation < options.generations) {
+    run_generation(&options, &state, candidates, game_seeds, scores, ranked);
+    printf("generation %3d: elite best %.1f, overall best %.1f\n",
+           state.generation, ranked[0].fitness, state.best_fitness);
+    fflush(stdout);
+
+    if (!save_checkpoint(options.checkpoint, &options, &state)) {
+      fprintf(stderr, "Cannot write checkpoint %s\n", options.checkpoint);
+    }
+  }
+
+  write_weights(stdout, "best", state.best);
+
+  free(candidates);
+  free(game_seeds);
+  free(scores);
+  free(ranked);
+  return EXIT_SUCCESS;
+}
@@ -1,9 +1,15 @@
 #include <check.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
+#include "autoplay.h"
+#include "corpus.h"
+#include "pipeline.h"
+#include "solver.h"
 #include "tetris.h"
 
 static const piece_t all_pieces[NUM_PIECES] = {
@@ -115,7 +121,43 @@ START_TEST(test_handle_input_drop) {
   // Verify the O-piece is locked at the bottom (rows 18-19, columns 4-5)
   for (int i = 18; i < 20; i++) {
     for (int j = 4; j < 6; j++) {
-      ck_assert(game_state.field[i][j].filled);
+      ck_assert(FIELD_ROW(&game_state, i)[j].filled);
+    }
+  }
+}
+END_TEST
+
+START_TEST(test_clear_multiple_lines) {
+  game_info_t game_state;
+  memset(&game_state, 0, sizeof(game_info_t));
+  initialize_game(&game_state, (game_timing_t[]){0});
+
+  // Four full rows missing column 0, with a marker block on top of them
+  for (int row = FIELD_HEIGHT - 4; row < FIELD_HEIGHT; row++) {
+    for (int col = 1; col < FIELD_WIDTH; col++) {
+      FIELD_ROW(&game_state, row)[col] = (cell_t){row, true};
+    }
+  }
+  FIELD_ROW(&game_state, FIELD_HEIGHT - 5)[5] = (cell_t){9, true};
+
+  game_state.current =
+      (piece_t){1, {{1, 0, 0, 0}, {1, 0, 0, 0}, {1, 0, 0, 0}, {1, 0, 0, 0}}};
+  game_state.current_x = 0;
+  handle_input(&game_state, USER_ACTION_DROP);
+  ck_assert_int_eq(game_state.score, 1500);
+
+  bool seen[FIELD_HEIGHT] = {0};
+  for (int row = 0; row < FIELD_HEIGHT; row++) {
+    ck_assert(!seen[game_state.rows[row]]);
+    seen[game_state.rows[row]] = true;
+  }
+
+  for (int row = 0; row < FIELD_HEIGHT; row++) {
+    for (int col = 0; col < FIELD_WIDTH; col++) {
+      const cell_t *cell = &FIELD_ROW(&game_state, row)[col];
+      const bool marker = row == FIELD_HEIGHT - 1 && col == 5;
+      ck_assert_int_eq(cell->filled, marker);
+      if (marker) ck_assert_int_eq(cell->color, 9);
     }
   }
 }
@@ -151,7 +193,7 @@ START_TEST(test_update_state) {
   timing.last_update += 1001;
   for (int col = 0; col < FIELD_WIDTH; col++) {
     if (col < 3 || col > 6) {
-      game_state.field[FIELD_HEIGHT - 1][col].filled = true;
+      FIELD_ROW(&game_state, FIELD_HEIGHT - 1)[col].filled = true;
     }
   }
   update_game_state(&game_state, &timing);
@@ -166,6 +208,379 @@ START_TEST(test_update_state) {
 }
 END_TEST
 
+START_TEST(test_gravity_ticks) {
+  game_info_t game_state;
+  game_timing_t timing;
+  initialize_game(&game_state, &timing);
+  update_game_state(&game_state, &timing);
+  game_state.current_y = 0;
+
+  // Ten seconds of 16 ms ticks must drop a 1000 ms gravity piece ten times
+  for (unsigned long tick = 1; tick <= 625; tick++) {
+    timing.clock = tick * 16;
+    update_game_state(&game_state, &timing);
+  }
+  ck_assert_int_eq(game_state.current_y, 10);
+  remove(HIGHSCORE_TXT);
+}
+END_TEST
+
+static corpus_record_t placement_record(const placement_info_t *placement) {
+  return (corpus_record_t){.piece = placement->piece,
+                           .x = placement->x,
+                           .y = placement->y,
+                           .rotation = placement->rotation,
+                           .lines = placement->lines,
+                           .level = placement->level,
+                           .score = placement->score,
+                           .game_over = placement->game_over};
+}
+
+START_TEST(test_corpus_segment) {
+  const char *dir = "test_corpus";
+  char path[512];
+  char manifest[512];
+  corpus_segment_path(dir, 0, path, sizeof(path));
+  snprintf(manifest, sizeof(manifest), "%s/%s", dir, CORPUS_MANIFEST);
+
+  game_info_t game_state;
+  memset(&game_state, 0, sizeof(game_info_t));
+  initialize_game(&game_state, (game_timing_t[]){0});
+  corpus_writer_t *corpus = corpus_open(dir);
+  ck_assert_ptr_nonnull(corpus);
+
+  // O-piece lands on columns 4-5 and completes the bottom row
+  game_state.current = all_pieces[1];
+  game_state.level = 3;
+  for (int col = 0; col < FIELD_WIDTH; col++) {
+    const bool filled = col < 4 || col > 5;
+    FIELD_ROW(&game_state, FIELD_HEIGHT - 1)[col].filled = filled;
+  }
+  handle_input(&game_state, USER_ACTION_DROP);
+  ck_assert_int_eq(game_state.placements, 1);
+  const corpus_record_t record = placement_record(&game_state.last_placement);
+  ck_assert(corpus_append(corpus, &record));
+
+  const corpus_record_t last = {.piece = 3, .level = 5, .game_over = true};
+  ck_assert(corpus_append(corpus, &last));
+  ck_assert(corpus_close(corpus));
+
+  // A corrupt manifest falls back to scanning the segments
+  FILE *file = fopen(manifest, "w");
+  ck_assert_ptr_nonnull(file);
+  fprintf(file, "segment -3\ngarbage\n");
+  fclose(file);
+
+  // A second session extends the same segment instead of starting a new one
+  corpus = corpus_open(dir);
+  ck_assert_ptr_nonnull(corpus);
+  ck_assert(corpus_append(corpus, &last));
+  ck_assert(corpus_close(corpus));
+
+  char next[512];
+  corpus_segment_path(dir, 1, next, sizeof(next));
+  ck_assert_int_ne(access(next, F_OK), 0);
+
+  corpus_segment_t segment;
+  ck_assert(corpus_segment_open(path, &segment));
+  ck_assert_int_eq(segment.header->count, 3);
+  ck_assert_int_eq(segment.header->runs, 2);
+  ck_assert_int_eq(segment.header->index[CORPUS_COLUMN_GAME].max, 1);
+  ck_assert_int_eq(segment.header->index[CORPUS_COLUMN_LEVEL].min, 3);
+  ck_assert_int_eq(segment.header->index[CORPUS_COLUMN_LEVEL].max, 5);
+  ck_assert(corpus_segment_overlaps(&segment, CORPUS_COLUMN_LEVEL, 4, 10));
+  ck_assert(!corpus_segment_overlaps(&segment, CORPUS_COLUMN_LEVEL, 6, 10));
+
+  const uint8_t *piece = corpus_segment_column(&segment, CORPUS_COLUMN_PIECE);
+  const int8_t *x = corpus_segment_column(&segment, CORPUS_COLUMN_X);
+  const uint8_t *lines = corpus_segment_column(&segment, CORPUS_COLUMN_LINES);
+  const uint16_t *score = corpus_segment_column(&segment, CORPUS_COLUMN_SCORE);
+  ck_assert_int_eq(piece[0], 2);
+  ck_assert_int_eq(x[0], FIELD_WIDTH / 2 - 2);
+  ck_assert_int_eq(lines[0], 1);
+  ck_assert_int_eq(score[0], 300);
+
+  uint8_t mask[3];
+  const uint8_t *level = corpus_segment_column(&segment, CORPUS_COLUMN_LEVEL);
+  ck_assert_int_eq(corpus_scan_range(level, 3, 4, 10, mask), 2);
+  ck_assert(!mask[0] && mask[1] && mask[2]);
+  corpus_segment_close(&segment);
+
+  remove(path);
+  remove(manifest);
+  rmdir(dir);
+}
+END_TEST
+
+START_TEST(test_corpus_scan_range) {
+  uint8_t column[100];
+  uint8_t mask[100];
+  for (int i = 0; i < 100; i++) column[i] = i % 10;
+
+  ck_assert_int_eq(corpus_scan_range(column, 100, 2, 4, mask), 30);
+  for (int i = 0; i < 100; i++) {
+    ck_assert_int_eq(mask[i] != 0, column[i] >= 2 && column[i] <= 4);
+  }
+}
+END_TEST
+
+START_TEST(test_action_queue) {
+  action_queue_t queue;
+  action_queue_init(&queue);
+  user_action_t action;
+
+  ck_assert(!action_queue_pop(&queue, &action));
+  for (int i = 0; i < ACTION_QUEUE_SIZE; i++) {
+    ck_assert(action_queue_push(&queue, i % USER_ACTION_NONE));
+  }
+  ck_assert(!action_queue_push(&queue, USER_ACTION_DROP));
+  ck_assert_int_eq(queue.dropped, 1);
+
+  for (int i = 0; i < ACTION_QUEUE_SIZE; i++) {
+    ck_assert(action_queue_pop(&queue, &action));
+    ck_assert_int_eq(action, i % USER_ACTION_NONE);
+  }
+  ck_assert(!action_queue_pop(&queue, &action));
+}
+END_TEST
+
+static void *produce_actions(void *arg) {
+  action_queue_t *queue = arg;
+  for (int i = 0; i < 100000; i++) {
+    while (!action_queue_push(queue, i % USER_ACTION_NONE)) continue;
+  }
+  return NULL;
+}
+
+START_TEST(test_action_queue_threads) {
+  action_queue_t queue;
+  action_queue_init(&queue);
+  pthread_t producer;
+  pthread_create(&producer, NULL, produce_actions, &queue);
+
+  for (int i = 0; i < 100000; i++) {
+    user_action_t action;
+    while (!action_queue_pop(&queue, &action)) continue;
+    ck_assert_int_eq(action, i % USER_ACTION_NONE);
+  }
+  pthread_join(producer, NULL);
+}
+END_TEST
+
+START_TEST(test_snapshot_buffer) {
+  game_info_t game_state;
+  memset(&game_state, 0, sizeof(game_info_t));
+  initialize_game(&game_state, (game_timing_t[]){0});
+
+  snapshot_buffer_t buffer;
+  snapshot_buffer_init(&buffer, &game_state);
+  ck_assert_ptr_null(snapshot_acquire(&buffer));
+
+  game_state.score = 100;
+  snapshot_publish(&buffer, &game_state);
+  game_state.score = 200;
+  snapshot_publish(&buffer, &game_state);
+  ck_assert_int_eq(buffer.published, 2);
+  ck_assert_int_eq(buffer.coalesced, 1);
+
+  const game_info_t *snapshot = snapshot_acquire(&buffer);
+  ck_assert_ptr_nonnull(snapshot);
+  ck_assert_int_eq(snapshot->score, 200);
+  ck_assert_ptr_null(snapshot_acquire(&buffer));
+
+  // Publishing again must not overwrite the snapshot being rendered
+  game_state.score = 300;
+  snapshot_publish(&buffer, &game_state);
+  ck_assert_int_eq(snapshot->score, 200);
+  ck_assert_int_eq(snapshot_acquire(&buffer)->score, 300);
+}
+END_TEST
+
+START_TEST(test_seed_game) {
+  game_info_t first;
+  game_info_t second;
+  initialize_game(&first, (game_timing_t[]){0});
+  initialize_game(&second, (game_timing_t[]){0});
+  seed_game(&first, 42);
+  seed_game(&second, 42);
+
+  for (int i = 0; i < 50; i++) {
+    ck_assert_int_eq(first.current.color_code, second.current.color_code);
+    ck_assert_int_eq(first.next.color_code, second.next.color_code);
+    handle_input(&first, USER_ACTION_DROP);
+    handle_input(&second, USER_ACTION_DROP);
+    if (first.is_game_over) break;
+  }
+}
+END_TEST
+
+START_TEST(test_autoplay_features) {
+  game_info_t game_state;
+  initialize_game(&game_state, (game_timing_t[]){0});
+  FIELD_ROW(&game_state, FIELD_HEIGHT - 3)[0].filled = true;
+  FIELD_ROW(&game_state, FIELD_HEIGHT - 1)[1].filled = true;
+
+  double features[AUTOPLAY_NUM_FEATURES];
+  autoplay_features(&game_state, 2, features);
+  ck_assert_int_eq(features[AUTOPLAY_FEATURE_HEIGHT], 4);
+  ck_assert_int_eq(features[AUTOPLAY_FEATURE_LINES], 2);
+  ck_assert_int_eq(features[AUTOPLAY_FEATURE_HOLES], 2);
+  ck_assert_int_eq(features[AUTOPLAY_FEATURE_BUMPINESS], 3);
+  ck_assert_int_eq(features[AUTOPLAY_FEATURE_MAX_HEIGHT], 3);
+}
+END_TEST
+
+START_TEST(test_autoplay_game) {
+  const double weights[AUTOPLAY_NUM_FEATURES] = {-0.5, 0.8, -0.4, -0.2, 0, 0};
+
+  const int score = autoplay_game(7, weights, 100);
+  ck_assert(score > 0);
+  ck_assert_int_eq(autoplay_game(7, weights, 100), score);
+}
+END_TEST
+
+START_TEST(test_autoplay_placements) {
+  const double weights[AUTOPLAY_NUM_FEATURES] = {-0.5, 0.8, -0.4, -0.2, 0, 0};
+  game_info_t game_state;
+  initialize_game(&game_state, (game_timing_t[]){0});
+  seed_game(&game_state, 3);
+
+  // Each move tries dozens of placements but must lock only one
+  for (unsigned long i = 1; i <= 10; i++) {
+    const int piece = game_state.current.color_code;
+    ck_assert(autoplay_move(&game_state, weights));
+    ck_assert_int_eq(game_state.placements, i);
+    ck_assert_int_eq(game_state.last_placement.piece, piece);
+  }
+}
+END_TEST
+
+static void fill_rows(game_info_t *game_state, int rows, int from, int to) {
+  for (int row = FIELD_HEIGHT - rows; row < FIELD_HEIGHT; row++) {
+    for (int col = 0; col < FIELD_WIDTH; col++) {
+      FIELD_ROW(game_state, row)[col].filled = col < from || col > to;
+    }
+  }
+}
+
+static void replay_moves(game_info_t *game_state, const piece_t *queue,
+                         const solver_result_t *result) {
+  for (int i = 0; i < result->length; i++) {
+    if (i > 0) {
+      game_state->current = queue[i - 1];
+      game_state->current_x = FIELD_WIDTH / 2 - 2;
+      game_state->current_y = 0;
+    }
+    for (int r = 0; r < result->moves[i].rotation; r++) {
+      handle_input(game_state, USER_ACTION_ROTATE);
+    }
+    while (game_state->current_x > result->moves[i].x) {
+      handle_input(game_state, USER_ACTION_LEFT);
+    }
+    while (game_state->current_x < result->moves[i].x) {
+      handle_input(game_state, USER_ACTION_RIGHT);
+    }
+    handle_input(game_state, USER_ACTION_DROP);
+  }
+}
+
+START_TEST(test_solver_single_piece) {
+  game_info_t game_state;
+  initialize_game(&game_state, (game_timing_t[]){0});
+  fill_rows(&game_state, 4, 0, 0);
+  game_state.current = all_pieces[0];  // I
+  game_state.current_x = FIELD_WIDTH / 2 - 2;
+
+  solver_result_t result;
+  ck_assert(solve_perfect_clear(&game_state, NULL, 0, 2, &result));
+  ck_assert_int_eq(result.length, 1);
+  ck_assert_int_eq(result.moves[0].rotation % 2, 1);
+  ck_assert_int_eq(result.moves[0].y, FIELD_HEIGHT - 4);
+
+  replay_moves(&game_state, NULL, &result);
+  ck_assert_int_eq(game_state.score, 1500);
+  for (int col = 0; col < FIELD_WIDTH; col++) {
+    ck_assert(!FIELD_ROW(&game_state, FIELD_HEIGHT - 1)[col].filled);
+  }
+}
+END_TEST
+
+START_TEST(test_solver_queue) {
+  game_info_t game_state;
+  initialize_game(&game_state, (game_timing_t[]){0});
+  fill_rows(&game_state, 2, 6, 9);
+  game_state.current = all_pieces[1];  // O
+  game_state.current_x = FIELD_WIDTH / 2 - 2;
+  const piece_t queue[] = {all_pieces[1], all_pieces[6]};
+
+  solver_result_t single;
+  solver_result_t parallel;
+  ck_assert(solve_perfect_clear(&game_state, queue, 2, 1, &single));
+  ck_assert(solve_perfect_clear(&game_state, queue, 2, 4, &parallel));
+  ck_assert_int_eq(single.length, 2);
+  ck_assert_int_eq(parallel.length, single.length);
+  for (int i = 0; i < single.length; i++) {
+    ck_assert_int_eq(parallel.moves[i].x, single.moves[i].x);
+    ck_assert_int_eq(parallel.moves[i].rotation, single.moves[i].rotation);
+  }
+
+  replay_moves(&game_state, queue, &single);
+  for (int row = 0; row < FIELD_HEIGHT; row++) {
+    for (int col = 0; col < FIELD_WIDTH; col++) {
+      ck_assert(!FIELD_ROW(&game_state, row)[col].filled);
+    }
+  }
+}
+END_TEST
+
+START_TEST(test_solver_reuse) {
+  game_info_t game_state;
+  initialize_game(&game_state, (game_timing_t[]){0});
+  fill_rows(&game_state, 2, 6, 9);
+  game_state.current = all_pieces[1];  // O
+  game_state.current_x = FIELD_WIDTH / 2 - 2;
+  const piece_t failing[] = {all_pieces[6], all_pieces[6]};
+  const piece_t queue[] = {all_pieces[1], all_pieces[6]};
+
+  solver_t *solver = solver_create(2);
+  ck_assert_ptr_nonnull(solver);
+
+  // Failures memoized for one queue must not leak into the next problem
+  solver_result_t result;
+  solver_result_t fresh;
+  ck_assert(!solver_solve(solver, &game_state, failing, 2, &result));
+  ck_assert(solver_solve(solver, &game_state, queue, 2, &result));
+  ck_assert(solve_perfect_clear(&game_state, queue, 2, 2, &fresh));
+  ck_assert_int_eq(result.length, fresh.length);
+  for (int i = 0; i < result.length; i++) {
+    ck_assert_int_eq(result.moves[i].x, fresh.moves[i].x);
+    ck_assert_int_eq(result.moves[i].rotation, fresh.moves[i].rotation);
+  }
+  solver_destroy(solver);
+}
+END_TEST
+
+START_TEST(test_solver_pruning) {
+  game_info_t game_state;
+  initialize_game(&game_state, (game_timing_t[]){0});
+  fill_rows(&game_state, 2, 6, 9);
+  game_state.current_x = FIELD_WIDTH / 2 - 2;
+  const piece_t queue[] = {all_pieces[3], all_pieces[4]};
+
+  // Eight empty cells, but S then L cannot cancel the column parity
+  solver_result_t result;
+  game_state.current = all_pieces[5];  // S
+  ck_assert(!solve_perfect_clear(&game_state, queue, 1, 1, &result));
+  ck_assert_int_eq(result.nodes, 1);
+
+  // Seven empty cells can never be filled by four-cell pieces
+  fill_rows(&game_state, 1, 7, 9);
+  game_state.current = all_pieces[0];
+  ck_assert(!solve_perfect_clear(&game_state, queue, 2, 1, &result));
+  ck_assert_int_eq(result.nodes, 1);
+}
+END_TEST
+
 Suite *tetris_suite(void) {
   Suite *suite = suite_create("Tetris");
   TCase *tc_core = tcase_create("Core");
@@ -174,9 +589,36 @@ Suite *tetris_suite(void) {
   tcase_add_test(tc_core, test_handle_action_destroy);
   tcase_add_test(tc_core, test_handle_action_rotate);
   tcase_add_test(tc_core, test_handle_input_drop);
+  tcase_add_test(tc_core, test_clear_multiple_lines);
   tcase_add_test(tc_core, test_update_state);
+  tcase_add_test(tc_core, test_gravity_ticks);
   suite_add_tcase(suite, tc_core);
 
+  TCase *tc_corpus = tcase_create("Corpus");
+  tcase_add_test(tc_corpus, test_corpus_segment);
+  tcase_add_test(tc_corpus, test_corpus_scan_range);
+  suite_add_tcase(suite, tc_corpus);
+
+  TCase *tc_pipeline = tcase_create("Pipeline");
+  tcase_add_test(tc_pipeline, test_action_queue);
+  tcase_add_test(tc_pipeline, test_action_queue_threads);
+  tcase_add_test(tc_pipeline, test_snapshot_buffer);
+  suite_add_tcase(suite, tc_pipeline);
+
+  TCase *tc_autoplay = tcase_create("Autoplay");
+  tcase_add_test(tc_autoplay, test_seed_game);
+  tcase_add_test(tc_autoplay, test_autoplay_features);
+  tcase_add_test(tc_autoplay, test_autoplay_game);
+  tcase_add_test(tc_autoplay, test_autoplay_placements);
+  suite_add_tcase(suite, tc_autoplay);
+
+  TCase *tc_solver = tcase_create("Solver");
+  tcase_add_test(tc_solver, test_solver_single_piece);
+  tcase_add_test(tc_solver, test_solver_queue);
+  tcase_add_test(tc_solver, test_solver_reuse);
+  tcase_add_test(tc_solver, test_solver_pruning);
+  suite_add_tcase(suite, tc_solver);
+
   return suite;
 }
 